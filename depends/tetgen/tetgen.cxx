@@ -3624,20 +3624,20 @@ bool tetgenbehavior::parse_commandline(int argc, char **argv)
 
 // Initialize fast lookup tables for mesh maniplulation primitives.
 
-int tetgenmesh::bondtbl[12][12] = {{0,},};
-int tetgenmesh::enexttbl[12] = {0,};
-int tetgenmesh::eprevtbl[12] = {0,};
-int tetgenmesh::enextesymtbl[12] = {0,};
-int tetgenmesh::eprevesymtbl[12] = {0,};
-int tetgenmesh::eorgoppotbl[12] = {0,};
-int tetgenmesh::edestoppotbl[12] = {0,};
-int tetgenmesh::fsymtbl[12][12] = {{0,},};
-int tetgenmesh::facepivot1[12] = {0,};
-int tetgenmesh::facepivot2[12][12] = {{0,},};
-int tetgenmesh::tsbondtbl[12][6] = {{0,},};
-int tetgenmesh::stbondtbl[12][6] = {{0,},};
-int tetgenmesh::tspivottbl[12][6] = {{0,},};
-int tetgenmesh::stpivottbl[12][6] = {{0,},};
+thread_local int tetgenmesh::bondtbl[12][12] = {{0,},};
+thread_local int tetgenmesh::enexttbl[12] = {0,};
+thread_local int tetgenmesh::eprevtbl[12] = {0,};
+thread_local int tetgenmesh::enextesymtbl[12] = {0,};
+thread_local int tetgenmesh::eprevesymtbl[12] = {0,};
+thread_local int tetgenmesh::eorgoppotbl[12] = {0,};
+thread_local int tetgenmesh::edestoppotbl[12] = {0,};
+thread_local int tetgenmesh::fsymtbl[12][12] = {{0,},};
+thread_local int tetgenmesh::facepivot1[12] = {0,};
+thread_local int tetgenmesh::facepivot2[12][12] = {{0,},};
+thread_local int tetgenmesh::tsbondtbl[12][6] = {{0,},};
+thread_local int tetgenmesh::stbondtbl[12][6] = {{0,},};
+thread_local int tetgenmesh::tspivottbl[12][6] = {{0,},};
+thread_local int tetgenmesh::stpivottbl[12][6] = {{0,},};
 
 // Table 'esymtbl' takes an directed edge (version) as input, returns the
 //   inversed edge (version) of it.
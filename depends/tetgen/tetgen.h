@@ -1393,14 +1393,17 @@ public:
 ///////////////////////////////////////////////////////////////////////////////
 
   // Fast lookup tables for mesh manipulation primitives.
-  static int bondtbl[12][12], fsymtbl[12][12];
-  static int esymtbl[12], enexttbl[12], eprevtbl[12];
-  static int enextesymtbl[12], eprevesymtbl[12]; 
-  static int eorgoppotbl[12], edestoppotbl[12];
-  static int facepivot1[12], facepivot2[12][12];
+  // The tables filled in by inittables() are thread-local, so that meshes
+  // can be built on several threads at once.
+  static thread_local int bondtbl[12][12], fsymtbl[12][12];
+  static int esymtbl[12];
+  static thread_local int enexttbl[12], eprevtbl[12];
+  static thread_local int enextesymtbl[12], eprevesymtbl[12];
+  static thread_local int eorgoppotbl[12], edestoppotbl[12];
+  static thread_local int facepivot1[12], facepivot2[12][12];
   static int orgpivot[12], destpivot[12], apexpivot[12], oppopivot[12];
-  static int tsbondtbl[12][6], stbondtbl[12][6];
-  static int tspivottbl[12][6], stpivottbl[12][6];
+  static thread_local int tsbondtbl[12][6], stbondtbl[12][6];
+  static thread_local int tspivottbl[12][6], stpivottbl[12][6];
   static int ver2edge[12], edge2ver[6], epivot[12];
   static int sorgpivot [6], sdestpivot[6], sapexpivot[6];
   static int snextpivot[6];
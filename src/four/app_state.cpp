@@ -1,7 +1,12 @@
 #include <four/app_state.hpp>
 
+#include <four/generate.hpp>
 #include <four/math.hpp>
+#include <four/mesh_binary.hpp>
+#include <four/mesh_cache.hpp>
+#include <four/operators.hpp>
 #include <four/resource.hpp>
+#include <four/surface.hpp>
 
 #include <imgui.h>
 #include <imgui_impl_opengl3.h>
@@ -21,10 +26,22 @@ const char* plane_str[] = {
         "xy", "xz", "xw", "yz", "yw", "zw",
 };
 
-const char* mesh_paths[] = {
-        "5-cell.mesh4", "Tesseract.mesh4", "16-cell.mesh4", "24-cell.mesh4", "120-cell.mesh4", "600-cell.mesh4",
+const char* generate_stage_str[] = {
+        "Placing vertices", "Finding edges", "Finding faces", "Finding cells", "Tetrahedralizing",
 };
 
+// Each of these is shipped in `data/meshes` both as XML and in the binary
+// format. The binary file loads without parsing, so the XML file is only read
+// if it is missing.
+const char* mesh_names[] = {
+        "5-cell", "Tesseract", "16-cell", "24-cell", "120-cell", "600-cell",
+};
+
+// Segments around each circle of the generated surfaces. Every cell of a
+// surface is a tetrahedron, so this is kept low enough for the cross-section
+// to be recalculated every frame.
+constexpr u32 surface_resolution = 24;
+
 inline bool imgui_drag_f64(const char* label, f64* value, f32 speed, const char* format = NULL) {
     return ImGui::DragScalar(label, ImGuiDataType_Double, value, speed, NULL, NULL, format, 1.0f);
 }
@@ -68,12 +85,27 @@ AppState::AppState(SDL_Window* window, ImGuiIO* imgui_io)
 
     meshes.push_back(Mesh4{});
 
-    for (const char* path : mesh_paths) {
-        auto res_path = std::string("meshes/") + path;
-        Mesh4 mesh = load_mesh_from_file(get_resource_path(res_path.c_str()).c_str());
+    for (const char* name : mesh_names) {
+        auto path = get_resource_path((std::string("meshes/") + name + binary_mesh_extension).c_str());
+        if (!is_binary_mesh_file(path.c_str())) {
+            path = get_resource_path((std::string("meshes/") + name + ".mesh4").c_str());
+        }
+        Mesh4 mesh;
+        if (!load_mesh_from_file(path.c_str(), mesh)) {
+            ABORT_F("Could not load %s", path.c_str());
+        }
         meshes.push_back(std::move(mesh));
     }
 
+    n3sphere_index = (u32)meshes.size();
+    meshes.push_back(generate_3sphere(surface_resolution));
+    clifford_torus_index = (u32)meshes.size();
+    meshes.push_back(generate_clifford_torus(surface_resolution));
+    spherinder_index = (u32)meshes.size();
+    meshes.push_back(generate_spherinder(surface_resolution));
+    cubinder_index = (u32)meshes.size();
+    meshes.push_back(generate_cubinder(surface_resolution));
+
     n5cell_index = mesh_with_name("5-cell");
     tesseract_index = mesh_with_name("Tesseract");
     n16cell_index = mesh_with_name("16-cell");
@@ -84,6 +116,13 @@ AppState::AppState(SDL_Window* window, ImGuiIO* imgui_io)
     add_mesh_instance(tesseract_index);
 }
 
+AppState::~AppState() {
+    if (generation) {
+        generation->progress.cancel = true;
+        generation->thread.join();
+    }
+}
+
 f64 AppState::screen_x(f64 x) {
     return x * window_width;
 }
@@ -144,6 +183,42 @@ void AppState::set_selected_mesh_instance(u32 mesh_instance) {
     selected_cell = 0;
 }
 
+void AppState::start_generation(std::string description,
+                                std::function<bool(const GenerateOptions&, Mesh4&)> generate) {
+    generation = std::make_unique<Generation>();
+    generation->description = std::move(description);
+    generate_error.clear();
+
+    Generation* g = generation.get();
+    const TetMode tet_mode = fewest_tets ? TetMode::fewest : TetMode::fans;
+    g->thread = std::thread([g, tet_mode, generate = std::move(generate)]() {
+        loguru::set_thread_name("generate");
+
+        GenerateOptions options;
+        options.tet_mode = tet_mode;
+        options.progress = &g->progress;
+        g->succeeded = generate(options, g->mesh);
+        g->finished.store(true, std::memory_order_release);
+    });
+}
+
+// Hand a finished generation's mesh over to `meshes`. This only moves the
+// mesh, so it does not hold up the frame.
+void AppState::finish_generation() {
+    if (!generation || !generation->finished.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    generation->thread.join();
+    if (generation->succeeded) {
+        meshes.push_back(std::move(generation->mesh));
+        add_mesh_instance((u32)meshes.size() - 1);
+    } else if (!generation->progress.cancelled()) {
+        generate_error = strprintf("Could not generate %s; see the log for details", generation->description.c_str());
+    }
+    generation.reset();
+}
+
 void AppState::calc_ui_size_screen() {
     ui_size_screen = window_width - screen_x(visualization_width);
 }
@@ -250,6 +325,8 @@ bool AppState::process_events_and_imgui() {
         }
     }
 
+    finish_generation();
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(window);
     ImGui::NewFrame();
@@ -503,6 +580,88 @@ bool AppState::process_events_and_imgui() {
         if (ImGui::Button("600-cell", button_size)) {
             add_mesh_instance(n600cell_index);
         }
+        if (ImGui::Button("3-sphere", button_size)) {
+            add_mesh_instance(n3sphere_index);
+        }
+        if (ImGui::Button("Clifford torus", button_size)) {
+            add_mesh_instance(clifford_torus_index);
+        }
+        if (ImGui::Button("Spherinder", button_size)) {
+            add_mesh_instance(spherinder_index);
+        }
+        if (ImGui::Button("Cubinder", button_size)) {
+            add_mesh_instance(cubinder_index);
+        }
+
+        ImGui::Spacing();
+        ImGui::Text("Generate");
+
+        ImGui::PushItemWidth(-1);
+        ImGui::InputTextWithHint("##generate_spec", "e.g. coxeter:3,4,3:1100", generate_spec.data(),
+                                 generate_spec.size());
+        ImGui::PopItemWidth();
+        ImGui::Checkbox("Fewest tetrahedra", &fewest_tets);
+
+        if (generation) {
+            const auto& progress = generation->progress;
+            const auto stage = progress.stage.load();
+            ImGui::TextWrapped("%s...", generate_stage_str[(size_t)stage]);
+            ImGui::Text("%u edges, %u faces, %u cells", progress.n_edges.load(), progress.n_faces.load(),
+                        progress.n_cells.load());
+
+            if (stage == GenerateProgress::Stage::tetrahedralize && progress.n_cells > 0) {
+                ImGui::ProgressBar((f32)progress.n_tetrahedralized_cells / (f32)progress.n_cells, button_size);
+            }
+
+            if (progress.cancelled()) {
+                ImGui::Text("Cancelling...");
+            } else if (ImGui::Button("Cancel", button_size)) {
+                generation->progress.cancel = true;
+            }
+        } else {
+            if (ImGui::Button("Generate##button", button_size)) {
+                std::string spec = generate_spec.data();
+                start_generation(strprintf("\"%s\"", spec.c_str()),
+                                 [spec, cache = mesh_cache](const GenerateOptions& options, Mesh4& out) {
+                                     return generate_cached(cache, spec.c_str(), options, out);
+                                 });
+            }
+
+            // `meshes` only grows once a generation has finished, so the
+            // selected mesh stays put while an operator reads it.
+            struct Operator {
+                const char* label;
+                const char* description;
+                bool (*apply)(const Mesh4&, Mesh4&, const GenerateProgress*);
+            };
+            static constexpr Operator operators[] = {
+                    {"Dual", "the dual", dual},
+                    {"Truncate", "the truncation", truncate},
+                    {"Rectify", "the rectification", rectify},
+                    {"Bitruncate", "the bitruncation", bitruncate},
+            };
+
+            if (!mesh_instances.empty()) {
+                ImGui::Text("Selected object");
+                for (const Operator& op : operators) {
+                    if (ImGui::Button(op.label, button_size)) {
+                        const Mesh4* mesh = &get_mesh(selected_mesh_instance);
+                        start_generation(strprintf("%s of %s", op.description, mesh->name.c_str()),
+                                         [mesh, apply = op.apply](const GenerateOptions& options, Mesh4& out) {
+                                             if (!apply(*mesh, out, options.progress)) {
+                                                 return false;
+                                             }
+                                             tetrahedralize(out, options.progress, options.tet_mode);
+                                             return !options.progress->cancelled();
+                                         });
+                    }
+                }
+            }
+        }
+
+        if (!generate_error.empty()) {
+            ImGui::TextWrapped("%s", generate_error.c_str());
+        }
     }
 
     ImGui::Spacing();
@@ -517,14 +676,19 @@ bool AppState::process_events_and_imgui() {
         const auto list_box_size = ImVec2(0, ImGui::GetContentRegionAvail().y);
 
         if (ImGui::ListBoxHeader("##selected_cell_empty", list_box_size)) {
-            for (u32 i = 0; i < mesh.cells.size(); i++) {
-                const auto fmt_str = "%u";
-                s32 str_size = snprintf(NULL, 0, fmt_str, i);
-                str_buffer.resize((size_t)str_size + 1);
-                snprintf(str_buffer.data(), str_buffer.size(), fmt_str, i);
-
-                if (ImGui::Selectable(str_buffer.data(), selected_cell == i)) {
-                    selected_cell = i;
+            // Surfaces have tens of thousands of cells, so only the visible
+            // rows are submitted.
+            ImGuiListClipper clipper((s32)mesh.cells.size());
+            while (clipper.Step()) {
+                for (u32 i = (u32)clipper.DisplayStart; i < (u32)clipper.DisplayEnd; i++) {
+                    const auto fmt_str = "%u";
+                    s32 str_size = snprintf(NULL, 0, fmt_str, i);
+                    str_buffer.resize((size_t)str_size + 1);
+                    snprintf(str_buffer.data(), str_buffer.size(), fmt_str, i);
+
+                    if (ImGui::Selectable(str_buffer.data(), selected_cell == i)) {
+                        selected_cell = i;
+                    }
                 }
             }
 
@@ -1,15 +1,23 @@
 #pragma once
 
+#include <four/generate.hpp>
 #include <four/math.hpp>
 #include <four/mesh.hpp>
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <random>
+#include <thread>
 
 struct SDL_Window;
 struct ImGuiIO;
 
 namespace four {
 
+class MeshCache;
+
 inline constexpr s32 plane4_n = 6;
 
 struct Camera4 {
@@ -42,6 +50,12 @@ public:
     std::mt19937 random_eng_32;
 
     bool debug = false;
+
+    // Cache for meshes generated from the UI, or null.
+    MeshCache* mesh_cache = NULL;
+
+    // Whether meshes generated from the UI use `TetMode::fewest`.
+    bool fewest_tets = false;
     bool wireframe_render = false;
 
     bool window_size_changed = false;
@@ -102,9 +116,29 @@ private:
     u32 n24cell_index;
     u32 n120cell_index;
     u32 n600cell_index;
+    u32 n3sphere_index;
+    u32 clifford_torus_index;
+    u32 spherinder_index;
+    u32 cubinder_index;
 
     MeshInstance dummy_mesh_instance = {};
 
+    // A mesh being generated on a background thread, from a spec entered in
+    // the UI or from an existing mesh. The thread sets `finished` once `mesh`
+    // and `succeeded` are ready to be read.
+    struct Generation {
+        std::string description;
+        GenerateProgress progress;
+        Mesh4 mesh;
+        bool succeeded = false;
+        std::atomic<bool> finished = false;
+        std::thread thread;
+    };
+
+    std::unique_ptr<Generation> generation;
+    std::array<char, 256> generate_spec = {};
+    std::string generate_error;
+
     // Temporary storage
     // -----------------
 
@@ -114,6 +148,7 @@ private:
 
 public:
     AppState(SDL_Window* window, ImGuiIO* imgui_io);
+    ~AppState();
 
     // Returns true if the application should exit
     bool process_events_and_imgui();
@@ -133,6 +168,8 @@ private:
     void add_mesh_instance(u32 mesh_index);
     void remove_mesh_instance(u32 mesh_instance);
     void set_selected_mesh_instance(u32 mesh_instance);
+    void start_generation(std::string description, std::function<bool(const GenerateOptions&, Mesh4&)> generate);
+    void finish_generation();
     bool is_mouse_around_x(f64 x);
     void calc_ui_size_screen();
     void validate_mesh_transform(MeshInstance& mesh_instance, const Transform4& old_transform);
@@ -0,0 +1,90 @@
+#include <four/batch.hpp>
+
+#include <four/parallel.hpp>
+
+#include <loguru.hpp>
+
+#include <ctype.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace four {
+
+std::vector<std::string> default_mesh_specs() {
+    // Slowest first, so that the rest fit in around them.
+    return {"120-cell", "600-cell", "24-cell", "16-cell", "Tesseract", "5-cell"};
+}
+
+std::vector<std::string> split_spec_list(const char* list) {
+    std::vector<std::string> specs;
+
+    const char* start = list;
+    while (true) {
+        const char* comma = strchr(start, ',');
+        const char* end = comma ? comma : start + strlen(start);
+
+        // A piece continues the previous spec if it is a number, possibly
+        // followed by more parameters after a colon, as in the "3:1000" of
+        // "coxeter:5,3,3:1000".
+        const char* c = start;
+        while (c < end && isdigit((unsigned char)*c)) {
+            c++;
+        }
+        const bool continues = !specs.empty() && c > start && (c == end || *c == ':');
+
+        if (continues) {
+            specs.back().push_back(',');
+            specs.back().append(start, end);
+        } else if (end > start) {
+            specs.emplace_back(start, end);
+        }
+
+        if (!comma) {
+            break;
+        }
+        start = comma + 1;
+    }
+
+    return specs;
+}
+
+bool generate_batch(const std::vector<std::string>& specs, const GenerateOptions& options, MeshCache* cache,
+                    const BinaryMeshOptions* binary) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto seconds_since = [](std::chrono::steady_clock::time_point t) -> f64 {
+        return std::chrono::duration<f64>(std::chrono::steady_clock::now() - t).count();
+    };
+
+    LOG_F(INFO, "Generating %lu meshes", specs.size());
+    std::atomic<u32> n_failed = 0;
+
+    parallel_for("batch", (u32)specs.size(), hardware_threads(), [&](u32 i, u32) {
+        const auto mesh_start = std::chrono::steady_clock::now();
+        const char* spec = specs[i].c_str();
+
+        Mesh4 mesh;
+        if (!generate_cached(cache, spec, options, mesh)) {
+            LOG_F(ERROR, "Could not generate mesh4 %s", spec);
+            n_failed++;
+            return;
+        }
+
+        const auto path = mesh.name + (binary ? binary_mesh_extension : ".mesh4");
+        const bool saved =
+            binary ? save_mesh_binary(mesh, path.c_str(), *binary) : save_mesh_to_file(mesh, path.c_str());
+        if (!saved) {
+            LOG_F(ERROR, "Could not save %s", path.c_str());
+            n_failed++;
+            return;
+        }
+
+        LOG_F(INFO, "Saved %s in %.2f s", path.c_str(), seconds_since(mesh_start));
+    });
+
+    LOG_F(INFO, "Generated %lu meshes in %.2f s", specs.size() - n_failed, seconds_since(start));
+    return n_failed == 0;
+}
+
+} // namespace four
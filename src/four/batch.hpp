@@ -0,0 +1,31 @@
+#pragma once
+
+#include <four/generate.hpp>
+#include <four/mesh_binary.hpp>
+#include <four/mesh_cache.hpp>
+
+#include <string>
+#include <vector>
+
+namespace four {
+
+// The specs of the meshes shipped in `data/meshes`.
+std::vector<std::string> default_mesh_specs();
+
+// Split a comma-separated list of specs, such as "5-cell,duoprism:3,4". A
+// comma followed by a number continues the parameters of the previous spec
+// rather than starting a new one.
+std::vector<std::string> split_spec_list(const char* list);
+
+// Generate and tetrahedralize each of `specs` and save it to `<name>.mesh4`, or
+// to `<name>.mesh4b` in the binary format, with the given options, if
+// `binary` is not null.
+// The meshes are worked on concurrently, so one can be tetrahedralized or
+// saved while others are still being generated, and the workers share the
+// thread budget of `parallel_for` with each mesh's own parallel work. Returns
+// false if any mesh could not be generated or saved; the rest are still
+// saved.
+bool generate_batch(const std::vector<std::string>& specs, const GenerateOptions& options, MeshCache* cache,
+                    const BinaryMeshOptions* binary = NULL);
+
+} // namespace four
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <four/math.hpp>
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <stdlib.h>
+
+#include <functional>
+
+namespace four {
+
+// Exact arithmetic in Q(√5), the field of numbers a + b√5 with rational a and
+// b. The coordinates and edge lengths of the regular polytopes built on the
+// golden ratio all lie in this field, so their vertices can be compared and
+// hashed exactly. Integer overflow aborts rather than silently wrapping.
+
+namespace exact_detail {
+
+inline s64 checked_add(s64 a, s64 b) {
+    s64 result;
+    CHECK_F(!__builtin_add_overflow(a, b, &result), "Integer overflow in exact arithmetic");
+    return result;
+}
+
+inline s64 checked_mul(s64 a, s64 b) {
+    s64 result;
+    CHECK_F(!__builtin_mul_overflow(a, b, &result), "Integer overflow in exact arithmetic");
+    return result;
+}
+
+inline s64 gcd(s64 a, s64 b) {
+    a = a < 0 ? -a : a;
+    b = b < 0 ? -b : b;
+    while (b != 0) {
+        s64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+} // namespace exact_detail
+
+// A rational number in lowest terms with a positive denominator, so that
+// equal values have equal representations.
+struct Rational {
+    s64 num;
+    s64 den;
+
+    constexpr Rational() noexcept : num(0), den(1) {}
+    constexpr Rational(s64 n) noexcept : num(n), den(1) {}
+
+    Rational(s64 n, s64 d) {
+        CHECK_NE_F(d, 0);
+        if (d < 0) {
+            n = -n;
+            d = -d;
+        }
+        const s64 g = exact_detail::gcd(n, d);
+        num = n / g;
+        den = d / g;
+    }
+
+    s32 sign() const {
+        return num > 0 ? 1 : (num < 0 ? -1 : 0);
+    }
+
+    f64 to_f64() const {
+        return (f64)num / (f64)den;
+    }
+};
+
+inline Rational operator-(const Rational& x) {
+    return Rational(-x.num, x.den);
+}
+
+inline Rational operator+(const Rational& a, const Rational& b) {
+    using namespace exact_detail;
+    const s64 g = gcd(a.den, b.den);
+    return Rational(checked_add(checked_mul(a.num, b.den / g), checked_mul(b.num, a.den / g)),
+                    checked_mul(a.den / g, b.den));
+}
+
+inline Rational operator-(const Rational& a, const Rational& b) {
+    return a + -b;
+}
+
+inline Rational operator*(const Rational& a, const Rational& b) {
+    using namespace exact_detail;
+    const s64 g1 = gcd(a.num, b.den);
+    const s64 g2 = gcd(b.num, a.den);
+    return Rational(checked_mul(a.num / g1, b.num / g2), checked_mul(a.den / g2, b.den / g1));
+}
+
+inline bool operator==(const Rational& a, const Rational& b) {
+    return a.num == b.num && a.den == b.den;
+}
+
+inline bool operator!=(const Rational& a, const Rational& b) {
+    return !(a == b);
+}
+
+// A number a + b√5.
+struct QSqrt5 {
+    Rational a;
+    Rational b;
+
+    constexpr QSqrt5() noexcept = default;
+    constexpr QSqrt5(s64 a) noexcept : a(a), b() {}
+    QSqrt5(Rational a, Rational b) noexcept : a(a), b(b) {}
+
+    // The sign of a + b√5, found by comparing a² with 5b² when a and b have
+    // opposite signs.
+    s32 sign() const {
+        const s32 sa = a.sign();
+        const s32 sb = b.sign();
+        if (sb == 0) {
+            return sa;
+        }
+        if (sa == 0 || sa == sb) {
+            return sb;
+        }
+        return (a * a - Rational(5) * b * b).sign() * sa;
+    }
+
+    f64 to_f64() const {
+        return a.to_f64() + b.to_f64() * sqrt(5.0);
+    }
+};
+
+inline QSqrt5 operator-(const QSqrt5& x) {
+    return QSqrt5(-x.a, -x.b);
+}
+
+inline QSqrt5 operator+(const QSqrt5& x, const QSqrt5& y) {
+    return QSqrt5(x.a + y.a, x.b + y.b);
+}
+
+inline QSqrt5 operator-(const QSqrt5& x, const QSqrt5& y) {
+    return QSqrt5(x.a - y.a, x.b - y.b);
+}
+
+inline QSqrt5 operator*(const QSqrt5& x, const QSqrt5& y) {
+    return QSqrt5(x.a * y.a + Rational(5) * x.b * y.b, x.a * y.b + x.b * y.a);
+}
+
+inline bool operator==(const QSqrt5& x, const QSqrt5& y) {
+    return x.a == y.a && x.b == y.b;
+}
+
+inline bool operator!=(const QSqrt5& x, const QSqrt5& y) {
+    return !(x == y);
+}
+
+inline bool operator<(const QSqrt5& x, const QSqrt5& y) {
+    return (x - y).sign() < 0;
+}
+
+// The golden ratio (1 + √5) / 2.
+inline QSqrt5 golden_ratio_exact() {
+    return QSqrt5(Rational(1, 2), Rational(1, 2));
+}
+
+// A four-dimensional vector with components in Q(√5).
+struct QVec4 {
+    QSqrt5 elements[4];
+
+    QVec4() = default;
+    QVec4(QSqrt5 x, QSqrt5 y, QSqrt5 z, QSqrt5 w) noexcept : elements{x, y, z, w} {}
+
+    QSqrt5& operator[](size_t index) {
+        return elements[index];
+    }
+
+    const QSqrt5& operator[](size_t index) const {
+        return elements[index];
+    }
+
+    glm::dvec4 to_dvec4() const {
+        return glm::dvec4(elements[0].to_f64(), elements[1].to_f64(), elements[2].to_f64(), elements[3].to_f64());
+    }
+};
+
+inline QVec4 operator-(const QVec4& u, const QVec4& v) {
+    return QVec4(u[0] - v[0], u[1] - v[1], u[2] - v[2], u[3] - v[3]);
+}
+
+inline QSqrt5 dot(const QVec4& u, const QVec4& v) {
+    return u[0] * v[0] + u[1] * v[1] + u[2] * v[2] + u[3] * v[3];
+}
+
+inline QSqrt5 length_sq(const QVec4& v) {
+    return dot(v, v);
+}
+
+inline bool operator==(const QVec4& u, const QVec4& v) {
+    return u[0] == v[0] && u[1] == v[1] && u[2] == v[2] && u[3] == v[3];
+}
+
+inline bool operator!=(const QVec4& u, const QVec4& v) {
+    return !(u == v);
+}
+
+} // namespace four
+
+namespace std {
+
+template <>
+struct hash<four::QSqrt5> {
+    size_t operator()(const four::QSqrt5& x) const {
+        size_t hash = 0;
+        four::hash_combine(hash, x.a.num);
+        four::hash_combine(hash, x.a.den);
+        four::hash_combine(hash, x.b.num);
+        four::hash_combine(hash, x.b.den);
+        return hash;
+    }
+};
+
+template <>
+struct hash<four::QVec4> {
+    size_t operator()(const four::QVec4& v) const {
+        size_t hash = 0;
+        for (size_t i = 0; i < 4; i++) {
+            four::hash_combine(hash, v[i]);
+        }
+        return hash;
+    }
+};
+} // namespace std
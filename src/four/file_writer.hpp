@@ -0,0 +1,121 @@
+#pragma once
+
+#include <four/utility.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <charconv>
+#include <memory>
+#include <string_view>
+
+namespace four {
+
+// Buffered output to a file. Writes go to a fixed-size buffer that is handed
+// to the file in large blocks when full, so memory use does not grow with the
+// amount written. Errors are remembered and reported by `close`.
+class FileWriter {
+public:
+    static constexpr size_t buffer_capacity = 1 << 20;
+
+private:
+    FILE* file_ = NULL;
+    std::unique_ptr<char[]> buffer_;
+    size_t size_ = 0;
+    bool ok_ = true;
+
+public:
+    FileWriter() = default;
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    ~FileWriter() {
+        close();
+    }
+
+    // Open `path` for writing, replacing any existing file. Returns false if
+    // it cannot be opened.
+    bool open(const char* path) {
+        close();
+        file_ = fopen(path, "wb");
+        if (!file_) {
+            return false;
+        }
+        // Our buffer is the only one needed.
+        setvbuf(file_, NULL, _IONBF, 0);
+        if (!buffer_) {
+            buffer_ = std::make_unique<char[]>(buffer_capacity);
+        }
+        size_ = 0;
+        ok_ = true;
+        return true;
+    }
+
+    // Flush and close the file. Returns false if any write failed.
+    bool close() {
+        if (!file_) {
+            return ok_;
+        }
+        flush();
+        ok_ = fclose(file_) == 0 && ok_;
+        file_ = NULL;
+        return ok_;
+    }
+
+    void write(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        if (size > buffer_capacity - size_) {
+            flush();
+            if (size >= buffer_capacity) {
+                ok_ = ok_ && fwrite(bytes, 1, size, file_) == size;
+                return;
+            }
+        }
+        memcpy(buffer_.get() + size_, bytes, size);
+        size_ += size;
+    }
+
+    void put(const char c) {
+        if (size_ == buffer_capacity) {
+            flush();
+        }
+        buffer_[size_++] = c;
+    }
+
+    void put(const std::string_view s) {
+        write(s.data(), s.size());
+    }
+
+    // Write `value` as text: the shortest form that reads back exactly, for
+    // floating point values.
+    template <class T>
+    void put_number(const T value) {
+        constexpr size_t max_length = 32;
+        if (buffer_capacity - size_ < max_length) {
+            flush();
+        }
+        const auto result = std::to_chars(buffer_.get() + size_, buffer_.get() + buffer_capacity, value);
+        size_ = (size_t)(result.ptr - buffer_.get());
+    }
+
+    // Write `count` zero bytes.
+    void pad(size_t count) {
+        static constexpr char zeros[64] = {};
+        while (count > 0) {
+            const size_t n = std::min(count, sizeof(zeros));
+            write(zeros, n);
+            count -= n;
+        }
+    }
+
+private:
+    void flush() {
+        if (size_ > 0) {
+            ok_ = ok_ && fwrite(buffer_.get(), 1, size_, file_) == size_;
+            size_ = 0;
+        }
+    }
+};
+
+} // namespace four
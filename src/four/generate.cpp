@@ -1,16 +1,25 @@
 #include <four/generate.hpp>
 
+#include <four/exact.hpp>
+#include <four/hull.hpp>
+#include <four/operators.hpp>
+#include <four/parallel.hpp>
+#include <four/point_index.hpp>
+#include <four/prism.hpp>
+#include <four/surface.hpp>
 #include <four/utility.hpp>
+#include <four/wythoff.hpp>
 
 #include <loguru.hpp>
 
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
-#include <mutex>
-#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -20,11 +29,9 @@ namespace four {
 
 namespace {
 
-const f64 golden_ratio = (1.0 + sqrt(5.0)) / 2.0;
-
 // Heap's algorithm (see https://en.wikipedia.org/wiki/Heap's_algorithm)
-void do_generate_permutations(s32 n, bool& even, glm::dvec4& temp, std::unordered_set<glm::dvec4>& out,
-                              bool only_even) {
+template <class Vec>
+void do_generate_permutations(s32 n, bool& even, Vec& temp, std::unordered_set<Vec>& out, bool only_even) {
     if (n == 1) {
         if (!only_even || even) {
             out.insert(temp);
@@ -33,9 +40,9 @@ void do_generate_permutations(s32 n, bool& even, glm::dvec4& temp, std::unordere
         for (s32 i = 0; i < n - 1; i++) {
             do_generate_permutations(n - 1, even, temp, out, only_even);
             if (n % 2 == 0) {
-                std::swap(temp[i], temp[n - 1]);
+                std::swap(temp[(size_t)i], temp[(size_t)n - 1]);
             } else {
-                std::swap(temp[0], temp[n - 1]);
+                std::swap(temp[0], temp[(size_t)n - 1]);
             }
             even = !even;
         }
@@ -43,11 +50,43 @@ void do_generate_permutations(s32 n, bool& even, glm::dvec4& temp, std::unordere
     }
 }
 
-inline void generate_permutations(glm::dvec4 in, std::unordered_set<glm::dvec4>& out, bool only_even = false) {
+template <class Vec>
+inline void generate_permutations(Vec in, std::unordered_set<Vec>& out, bool only_even = false) {
     bool even = true;
     do_generate_permutations(4, even, in, out, only_even);
 }
 
+// Add every combination of sign changes of each of `in` to `out`, skipping
+// duplicates.
+inline void generate_sign_changes(const std::unordered_set<QVec4>& in, std::vector<QVec4>& out) {
+    std::unordered_set<QVec4> seen;
+    for (QVec4 v : in) {
+        for (s32 a = 0; a < 2; a++) {
+            for (s32 b = 0; b < 2; b++) {
+                for (s32 c = 0; c < 2; c++) {
+                    for (s32 d = 0; d < 2; d++) {
+                        if (seen.insert(v).second) {
+                            out.push_back(v);
+                        }
+                        v[3] = -v[3];
+                    }
+                    v[2] = -v[2];
+                }
+                v[1] = -v[1];
+            }
+            v[0] = -v[0];
+        }
+    }
+}
+
+// Exact constants for the polytopes built on the golden ratio.
+const QSqrt5 phi = golden_ratio_exact();
+const QSqrt5 phi_inv = phi - 1;
+const QSqrt5 phi_sq = phi + 1;
+const QSqrt5 phi_inv_sq = 2 - phi;
+const QSqrt5 sqrt5 = QSqrt5(0, 1);
+const QSqrt5 half = QSqrt5(Rational(1, 2), 0);
+
 // clang-format off
 const glm::dvec4 n5cell_vertices[5] = {
     { 1.0/sqrt(10.0),     1.0/sqrt(6.0),  1.0/sqrt(3.0),  1.0},
@@ -108,7 +147,7 @@ const s32 n16cell_faces_per_cell = 4;
 const s32 n16cell_n_cells = 16;
 
 // clang-format off
-const glm::dvec4 n24cell_vertices[24] = {
+const QVec4 n24cell_vertices[24] = {
     { 1,  1,  0,  0},
     { 1,  0,  1,  0},
     { 1,  0,  0,  1},
@@ -136,28 +175,29 @@ const glm::dvec4 n24cell_vertices[24] = {
 };
 // clang-format on
 
-const f64 n24cell_edge_length = sqrt(2.0);
+// Squared edge length.
+const QSqrt5 n24cell_edge_length_sq = 2;
 const s32 n24cell_edges_per_face = 3;
 const s32 n24cell_faces_per_cell = 8;
 const s32 n24cell_n_cells = 24;
 
 // clang-format off
-const glm::dvec4 n120cell_base_vertices[] = {
-    {0, 0, 2, 2},
-    {1, 1, 1, sqrt(5.0)},
-    {pow(golden_ratio, -2.0), golden_ratio, golden_ratio, golden_ratio},
-    {pow(golden_ratio, -1.0), pow(golden_ratio, -1.0), pow(golden_ratio, -1.0), pow(golden_ratio, 2.0)},
+const QVec4 n120cell_base_vertices[] = {
+    {0,          0,       2,       2},
+    {1,          1,       1,       sqrt5},
+    {phi_inv_sq, phi,     phi,     phi},
+    {phi_inv,    phi_inv, phi_inv, phi_sq},
 };
 
-const glm::dvec4 n120cell_base_vertices_even[] = {
-    {0, pow(golden_ratio, -2.0), 1, pow(golden_ratio, 2.0)},
-    {0, pow(golden_ratio, -1.0), golden_ratio, sqrt(5.0)},
-    {pow(golden_ratio, -1.0), 1, golden_ratio, 2},
+const QVec4 n120cell_base_vertices_even[] = {
+    {0,       phi_inv_sq, 1,   phi_sq},
+    {0,       phi_inv,    phi, sqrt5},
+    {phi_inv, 1,          phi, 2},
 };
 // clang-format on
 
-std::vector<glm::dvec4> generate_120cell_vertices() {
-    std::unordered_set<glm::dvec4> permutations;
+std::vector<QVec4> generate_120cell_vertices() {
+    std::unordered_set<QVec4> permutations;
 
     for (const auto& v : n120cell_base_vertices) {
         generate_permutations(v, permutations);
@@ -167,431 +207,1236 @@ std::vector<glm::dvec4> generate_120cell_vertices() {
         generate_permutations(v, permutations, true);
     }
 
-    std::vector<glm::dvec4> vertices;
-    std::unordered_set<glm::dvec4> seen;
-    for (glm::dvec4 v : permutations) {
-        for (s32 a = 0; a < 2; a++) {
-            for (s32 b = 0; b < 2; b++) {
-                for (s32 c = 0; c < 2; c++) {
-                    for (s32 d = 0; d < 2; d++) {
-                        if (seen.insert(v).second) {
-                            vertices.push_back(v);
-                        }
-                        v[3] = -v[3];
-                    }
-                    v[2] = -v[2];
-                }
-                v[1] = -v[1];
-            }
-            v[0] = -v[0];
-        }
-    }
-
+    std::vector<QVec4> vertices;
+    generate_sign_changes(permutations, vertices);
     return vertices;
 }
 
-const f64 n120cell_edge_length = 2.0 / pow(golden_ratio, 2.0);
+// Squared edge length: (2 / phi^2)^2.
+const QSqrt5 n120cell_edge_length_sq = QSqrt5(4, 0) * phi_inv_sq * phi_inv_sq;
 const s32 n120cell_edges_per_face = 5;
 const s32 n120cell_faces_per_cell = 12;
 const s32 n120cell_n_cells = 120;
 
-const glm::dvec4 n600cell_base_vertex0 = {0.5, 0.5, 0.5, 0.5};
-const glm::dvec4 n600cell_base_vertex1 = {0, 0, 0, 1};
-const glm::dvec4 n600cell_base_vertex2 = {golden_ratio / 2.0, 0.5, 1.0 / (2 * golden_ratio), 0};
+const QVec4 n600cell_base_vertex0 = {half, half, half, half};
+const QVec4 n600cell_base_vertex1 = {0, 0, 0, 1};
+const QVec4 n600cell_base_vertex2 = {half * phi, half, half * phi_inv, 0};
 
-std::vector<glm::dvec4> generate_600cell_vertices() {
-    std::unordered_set<glm::dvec4> permutations;
+std::vector<QVec4> generate_600cell_vertices() {
+    std::unordered_set<QVec4> permutations;
 
     permutations.insert(n600cell_base_vertex0);
     generate_permutations(n600cell_base_vertex1, permutations);
     generate_permutations(n600cell_base_vertex2, permutations, true);
 
-    std::vector<glm::dvec4> vertices;
-    std::unordered_set<glm::dvec4> seen;
-    for (glm::dvec4 v : permutations) {
-        for (s32 a = 0; a < 2; a++) {
-            for (s32 b = 0; b < 2; b++) {
-                for (s32 c = 0; c < 2; c++) {
-                    for (s32 d = 0; d < 2; d++) {
-                        if (seen.insert(v).second) {
-                            vertices.push_back(v);
-                        }
-                        v[3] = -v[3];
-                    }
-                    v[2] = -v[2];
-                }
-                v[1] = -v[1];
-            }
-            v[0] = -v[0];
-        }
-    }
-
+    std::vector<QVec4> vertices;
+    generate_sign_changes(permutations, vertices);
     return vertices;
 }
 
-const f64 n600cell_edge_length = 1.0 / golden_ratio;
+// Squared edge length: (1 / phi)^2.
+const QSqrt5 n600cell_edge_length_sq = phi_inv_sq;
 const s32 n600cell_edges_per_face = 3;
 const s32 n600cell_faces_per_cell = 4;
 const s32 n600cell_n_cells = 600;
 
-// Generate a regular convex 4-polytope.
-Mesh4 generate_mesh4(const glm::dvec4* vertices, const u32 n_vertices, const f64 edge_length, const s32 edges_per_face,
-                     const s32 faces_per_cell, const s32 n_cells) {
-    Mesh4 mesh;
+// Find every pair of vertices that are `edge_length` apart. Vertices are
+// binned into a uniform 4D grid with cells at least as wide as the longest
+// distance the prefilter accepts, so only the 3^4 neighbouring grid cells of
+// each vertex need to be searched. Each edge is found once, from its
+// lower-indexed vertex.
+//
+// Pairs that are approximately `edge_length` apart are passed to
+// `is_edge(i, j, dist_sq)`, which makes the final decision.
+template <class IsEdge>
+std::vector<Edge> find_edges(const std::vector<glm::dvec4>& vertices, const f64 edge_length, IsEdge&& is_edge) {
+    std::vector<Edge> edges;
+    if (vertices.empty()) {
+        return edges;
+    }
 
-    mesh.vertices = std::vector<glm::dvec4>(vertices, vertices + n_vertices);
-    LOG_F(INFO, "%lu vertices", mesh.vertices.size());
+    glm::dvec4 min = vertices[0];
+    glm::dvec4 max = vertices[0];
+    for (const auto& v : vertices) {
+        min = glm::min(min, v);
+        max = glm::max(max, v);
+    }
 
-    // Find edges: calculate the distance between each pair of vertices. If the
-    // distance equals the edge length, those vertices make up an edge.
-    {
-        std::unordered_set<Edge> edge_set;
+    // Conservative bound for the squared-distance prefilter; matches are then
+    // checked by `is_edge`.
+    const f64 max_dist = edge_length * (1.0 + 0.000001);
+    const f64 max_dist_sq = sq(max_dist);
+
+    // Widen the grid cells if necessary so that a cell index fits in 16 bits
+    // per axis and the whole grid index fits in a `u64`.
+    const f64 max_extent = std::max(std::max(max.x - min.x, max.y - min.y), std::max(max.z - min.z, max.w - min.w));
+    const f64 cell_size = std::max(max_dist, max_extent / 65000.0);
+
+    u64 dims[4];
+    for (s32 i = 0; i < 4; i++) {
+        dims[i] = (u64)((max[i] - min[i]) / cell_size) + 1;
+    }
+
+    const auto cell_coord = [&](const glm::dvec4& v, s32 axis) -> s64 {
+        return (s64)((v[axis] - min[axis]) / cell_size);
+    };
+
+    const auto cell_index = [&](const s64 (&coord)[4]) -> u64 {
+        return (((u64)coord[3] * dims[2] + (u64)coord[2]) * dims[1] + (u64)coord[1]) * dims[0] + (u64)coord[0];
+    };
+
+    // Sort vertex indices by grid cell, so each occupied cell is a contiguous
+    // range of `sorted`.
+    std::vector<std::pair<u64, u32>> sorted;
+    sorted.reserve(vertices.size());
+    for (u32 i = 0; i < vertices.size(); i++) {
+        const auto& v = vertices[i];
+        const s64 coord[4] = {cell_coord(v, 0), cell_coord(v, 1), cell_coord(v, 2), cell_coord(v, 3)};
+        sorted.emplace_back(cell_index(coord), i);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::unordered_map<u64, std::pair<u32, u32>> cell_ranges;
+    for (u32 i = 0; i < sorted.size();) {
+        u32 end = i + 1;
+        while (end < sorted.size() && sorted[end].first == sorted[i].first) {
+            end++;
+        }
+        cell_ranges.emplace(sorted[i].first, std::make_pair(i, end));
+        i = end;
+    }
+
+    // Candidate vertices from the neighbouring cells are gathered into
+    // separate coordinate arrays, so the distance loop below is a simple
+    // vectorizable kernel.
+    std::vector<f64> xs, ys, zs, ws, dist_sq;
+    std::vector<u32> indices;
+
+    for (u32 range_start = 0; range_start < sorted.size();) {
+        const u64 cell = sorted[range_start].first;
+        const u32 range_end = cell_ranges.at(cell).second;
+
+        s64 coord[4];
+        {
+            const auto& v = vertices[sorted[range_start].second];
+            for (s32 i = 0; i < 4; i++) {
+                coord[i] = cell_coord(v, i);
+            }
+        }
+
+        xs.clear();
+        ys.clear();
+        zs.clear();
+        ws.clear();
+        indices.clear();
+
+        for (s32 n = 0; n < 81; n++) {
+            s64 neighbour[4];
+            bool in_grid = true;
+            for (s32 i = 0, rest = n; i < 4; i++, rest /= 3) {
+                neighbour[i] = coord[i] + rest % 3 - 1;
+                in_grid = in_grid && neighbour[i] >= 0 && (u64)neighbour[i] < dims[i];
+            }
+
+            if (!in_grid) {
+                continue;
+            }
+
+            const auto it = cell_ranges.find(cell_index(neighbour));
+            if (it == cell_ranges.cend()) {
+                continue;
+            }
+
+            for (u32 i = it->second.first; i < it->second.second; i++) {
+                const auto& v = vertices[sorted[i].second];
+                xs.push_back(v.x);
+                ys.push_back(v.y);
+                zs.push_back(v.z);
+                ws.push_back(v.w);
+                indices.push_back(sorted[i].second);
+            }
+        }
+
+        const size_t n_candidates = indices.size();
+        dist_sq.resize(n_candidates);
 
-        for (u32 i = 0; i < mesh.vertices.size(); i++) {
-            for (u32 j = 0; j < mesh.vertices.size(); j++) {
-                if (j != i && float_eq(glm::length(mesh.vertices[j] - mesh.vertices[i]), edge_length)) {
-                    edge_set.insert(Edge(i, j));
+        for (u32 i = range_start; i < range_end; i++) {
+            const u32 vertex_i = sorted[i].second;
+            const glm::dvec4 v = vertices[vertex_i];
+
+            for (size_t j = 0; j < n_candidates; j++) {
+                const f64 dx = xs[j] - v.x;
+                const f64 dy = ys[j] - v.y;
+                const f64 dz = zs[j] - v.z;
+                const f64 dw = ws[j] - v.w;
+                dist_sq[j] = dx * dx + dy * dy + dz * dz + dw * dw;
+            }
+
+            for (size_t j = 0; j < n_candidates; j++) {
+                if (dist_sq[j] <= max_dist_sq && indices[j] > vertex_i && is_edge(vertex_i, indices[j], dist_sq[j])) {
+                    edges.emplace_back(vertex_i, indices[j]);
                 }
             }
         }
 
-        mesh.edges = std::vector<Edge>(edge_set.cbegin(), edge_set.cend());
-        LOG_F(INFO, "Found %lu edges", mesh.edges.size());
+        range_start = range_end;
     }
 
-    // Find faces: for each vertex, perform a depth-first search on vertices
-    // connected by edges, keeping track of the search path as a list of edges.
-    // Add the search path if it is a valid face -- each vertex of the path is
-    // shared by two and only two edges.
-    {
-        u32 vertex_edge_n = 0;
-        for (const auto& edge : mesh.edges) {
-            if (edge.v0 == 0 || edge.v1 == 0) {
-                vertex_edge_n++;
+    return edges;
+}
+
+constexpr s32 max_edges_per_face = 16;
+
+// The edges around each vertex, in compressed form: the neighbours of vertex
+// `v` are `entries[start[v]]` up to `entries[start[v + 1]]`.
+struct VertexAdjacency {
+    struct Entry {
+        u32 vertex;
+        u32 edge;
+    };
+
+    std::vector<u32> start;
+    std::vector<Entry> entries;
+
+    VertexAdjacency(const size_t n_vertices, const std::vector<Edge>& edges) : start(n_vertices + 1, 0) {
+        for (const auto& edge : edges) {
+            start[edge.v0 + 1]++;
+            start[edge.v1 + 1]++;
+        }
+        for (size_t v = 0; v < n_vertices; v++) {
+            start[v + 1] += start[v];
+        }
+
+        entries.resize(start[n_vertices]);
+        std::vector<u32> fill(start.cbegin(), start.cend() - 1);
+        for (u32 edge_i = 0; edge_i < edges.size(); edge_i++) {
+            const Edge& edge = edges[edge_i];
+            entries[fill[edge.v0]++] = {edge.v1, edge_i};
+            entries[fill[edge.v1]++] = {edge.v0, edge_i};
+        }
+    }
+};
+
+// Call `fn(edges)` for each simple cycle of `cycle_len` edges through `start`,
+// where `edges` points to the cycle's edge indices. Each cycle is found once,
+// in the direction whose second vertex is smaller than its last. If
+// `start_is_smallest`, only cycles whose other vertices all have higher indices
+// than `start` are found.
+template <class Fn>
+void for_each_cycle(const VertexAdjacency& adjacency, const u32 start, const u32 cycle_len,
+                    const bool start_is_smallest, Fn&& fn) {
+
+    // The search path: `path_vertices[d]` is the vertex at depth `d`, reached
+    // by `path_edges[d - 1]`. `cursors[d]` is the next adjacency entry of
+    // `path_vertices[d]` to try.
+    u32 path_vertices[max_edges_per_face];
+    u32 path_edges[max_edges_per_face];
+    u32 cursors[max_edges_per_face];
+
+    path_vertices[0] = start;
+    cursors[0] = adjacency.start[start];
+    u32 depth = 0;
+
+    while (true) {
+        const u32 vertex = path_vertices[depth];
+        if (cursors[depth] == adjacency.start[vertex + 1]) {
+            if (depth == 0) {
+                break;
             }
+            depth--;
+            continue;
         }
 
-        std::vector<u32> vertex_edge_indices;
-        vertex_edge_indices.reserve(mesh.vertices.size() * vertex_edge_n);
+        const auto next = adjacency.entries[cursors[depth]++];
 
-        for (u32 i = 0; i < mesh.vertices.size(); i++) {
-            for (u32 edge_i = 0; edge_i < mesh.edges.size(); edge_i++) {
-                const Edge& edge = mesh.edges[edge_i];
-                if (edge.v0 == i || edge.v1 == i) {
-                    vertex_edge_indices.push_back(edge_i);
-                }
+        if (depth == cycle_len - 1) {
+            // Closing edge: accept the cycle once, in canonical direction.
+            if (next.vertex == start && path_vertices[1] < vertex) {
+                path_edges[depth] = next.edge;
+                fn((const u32*)path_edges);
+            }
+            continue;
+        }
+
+        if (next.vertex == start || (start_is_smallest && next.vertex < start)) {
+            continue;
+        }
+
+        bool on_path = false;
+        for (u32 d = 1; d <= depth; d++) {
+            if (path_vertices[d] == next.vertex) {
+                on_path = true;
+                break;
             }
         }
+        if (on_path) {
+            continue;
+        }
+
+        path_edges[depth] = next.edge;
+        depth++;
+        path_vertices[depth] = next.vertex;
+        cursors[depth] = adjacency.start[next.vertex];
+    }
+}
+
+// Find every simple cycle of `cycle_len` edges. See `generate_mesh4`.
+std::vector<Face> find_faces(const size_t n_vertices, const std::vector<Edge>& edges, const u32 cycle_len,
+                             GenerateProgress* progress) {
+    const VertexAdjacency adjacency(n_vertices, edges);
+    std::vector<Face> faces;
+
+    for (u32 start = 0; start < n_vertices; start++) {
+        if (progress) {
+            if (progress->cancelled()) {
+                break;
+            }
+            progress->n_faces = (u32)faces.size();
+        }
+
+        for_each_cycle(adjacency, start, cycle_len, true,
+                       [&](const u32* cycle) { faces.emplace_back(cycle, cycle + cycle_len); });
+    }
+
+    return faces;
+}
+
+// Finds the hyperplanes of the cells of a convex polytope around a face. For
+// each pair of faces sharing an edge, the hyperplane through both is a cell's
+// hyperplane if it supports the polytope.
+struct ConvexCellPlanes {
+    const Mesh4& mesh;
+    const VertexAdjacency adjacency;
 
-        CHECK_EQ_F(vertex_edge_indices.size(), mesh.vertices.size() * vertex_edge_n);
+    // Faces containing each edge, in compressed form.
+    std::vector<u32> edge_faces_start;
+    std::vector<u32> edge_faces;
 
-        std::unordered_map<u32, s32> vertices_count;
-        const auto face_is_valid = [&](const std::unordered_set<u32>& face) -> bool {
-            vertices_count.clear();
+    glm::dvec4 centroid;
+    f64 epsilon;
 
+    ConvexCellPlanes(const Mesh4& mesh, const f64 edge_length)
+            : mesh(mesh), adjacency(mesh.vertices.size(), mesh.edges), edge_faces_start(mesh.edges.size() + 1, 0),
+              centroid(0, 0, 0, 0), epsilon(edge_length * 0.000000001) {
+
+        for (const auto& face : mesh.faces) {
             for (u32 edge_i : face) {
-                const Edge& edge = mesh.edges[edge_i];
-                for (u32 vert_i : edge.vertices) {
-                    if (!has_key(vertices_count, vert_i)) {
-                        vertices_count.emplace(vert_i, 1);
-                    } else {
-                        vertices_count[vert_i] += 1;
-                        if (vertices_count[vert_i] > 2) {
-                            return false;
+                edge_faces_start[edge_i + 1]++;
+            }
+        }
+        for (size_t e = 0; e < mesh.edges.size(); e++) {
+            edge_faces_start[e + 1] += edge_faces_start[e];
+        }
+
+        edge_faces.resize(edge_faces_start.back());
+        std::vector<u32> fill(edge_faces_start.cbegin(), edge_faces_start.cend() - 1);
+        for (u32 face_i = 0; face_i < mesh.faces.size(); face_i++) {
+            for (u32 edge_i : mesh.faces[face_i]) {
+                edge_faces[fill[edge_i]++] = face_i;
+            }
+        }
+
+        for (const auto& v : mesh.vertices) {
+            centroid += v;
+        }
+        centroid /= (f64)mesh.vertices.size();
+    }
+
+    // Call `fn(normal)` with the outward unit normal of each supporting
+    // hyperplane through `face_i` and a face sharing one of its edges. The
+    // same hyperplane may be passed more than once. Returns false if the
+    // polytope is degenerate.
+    template <class Fn>
+    bool for_each_plane(const u32 face_i, Fn&& fn) const {
+        const Face& face = mesh.faces[face_i];
+
+        // Three distinct vertices of a convex polygon are never collinear.
+        const Edge& edge0 = mesh.edges[face[0]];
+        const Edge& edge1 = mesh.edges[face[1]];
+        const u32 a = edge0.v0;
+        const u32 b = edge0.v1;
+        const u32 c = edge1.v0 == a || edge1.v0 == b ? edge1.v1 : edge1.v0;
+        const glm::dvec4 p = mesh.vertices[a];
+
+        for (u32 edge_i : face) {
+            for (u32 i = edge_faces_start[edge_i]; i < edge_faces_start[edge_i + 1]; i++) {
+                const u32 other_i = edge_faces[i];
+                if (other_i == face_i) {
+                    continue;
+                }
+
+                // A vertex of the other face that is not on the shared edge.
+                const Edge& shared = mesh.edges[edge_i];
+                u32 q = shared.v0;
+                for (u32 other_edge_i : mesh.faces[other_i]) {
+                    const Edge& other_edge = mesh.edges[other_edge_i];
+                    for (u32 v : other_edge.vertices) {
+                        if (v != shared.v0 && v != shared.v1) {
+                            q = v;
                         }
                     }
                 }
-            }
 
-            for (const auto& entry : vertices_count) {
-                if (entry.second != 2) {
+                glm::dvec4 normal = cross(mesh.vertices[b] - p, mesh.vertices[c] - p, mesh.vertices[q] - p);
+                const f64 length = glm::length(normal);
+                if (length <= epsilon * epsilon) {
                     return false;
                 }
+                normal /= length;
+
+                f64 offset = glm::dot(normal, p);
+                if (glm::dot(normal, centroid) > offset) {
+                    normal = -normal;
+                    offset = -offset;
+                }
+
+                // For a convex polytope, the hyperplane supports the whole
+                // polytope if it supports the edges leaving one of its
+                // vertices.
+                bool supporting = true;
+                for (u32 j = adjacency.start[a]; j < adjacency.start[a + 1]; j++) {
+                    if (glm::dot(normal, mesh.vertices[adjacency.entries[j].vertex]) > offset + epsilon) {
+                        supporting = false;
+                        break;
+                    }
+                }
+
+                if (supporting) {
+                    fn(normal);
+                }
             }
+        }
 
-            return true;
-        };
+        return true;
+    }
+};
 
-        std::unordered_set<Face, FaceHash, FaceEquals> face_set;
-        std::unordered_set<u32> edge_path;
+// Returns true if every face belongs to exactly two of `cells`, i.e. the cells
+// form a closed surface.
+bool cells_are_closed(const Mesh4& mesh, const std::vector<Cell>& cells) {
+    std::vector<u8> face_cell_count(mesh.faces.size(), 0);
+    for (const auto& cell : cells) {
+        for (u32 face_i : cell) {
+            face_cell_count[face_i]++;
+        }
+    }
+    for (u8 count : face_cell_count) {
+        if (count != 2) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        // Recursive lambda definition
-        std::function<void(u32)> fill_face_set;
-        fill_face_set = [&](u32 vertex_i) {
-            CHECK_LE_F(edge_path.size(), (size_t)edges_per_face);
+// Find the cells of a convex polytope: each cell is the set of faces lying in
+// one supporting hyperplane. Faces are bucketed by the hyperplane's outward
+// unit normal, which is unique to each cell. Returns false if the result is
+// not a valid set of `n_cells` cells, e.g. because the polytope is not convex.
+bool find_cells_by_hyperplane(const Mesh4& mesh, const f64 edge_length, const s32 n_cells, std::vector<Cell>& out) {
+    const ConvexCellPlanes planes(mesh, edge_length);
+
+    PointIndex4 normal_index;
+    std::vector<Cell> cells;
+
+    for (u32 face_i = 0; face_i < mesh.faces.size(); face_i++) {
+        const bool ok = planes.for_each_plane(face_i, [&](const glm::dvec4& normal) {
+            u32 cell_i;
+            if (!normal_index.find(normal, cell_i)) {
+                cell_i = (u32)cells.size();
+                normal_index.insert(normal, cell_i);
+                cells.emplace_back();
+            }
 
-            if (edge_path.size() == (size_t)edges_per_face) {
-                if (face_is_valid(edge_path)) {
-                    face_set.emplace(edge_path.cbegin(), edge_path.cend());
-                }
-            } else {
-                for (u32 i = 0; i < vertex_edge_n; i++) {
-                    u32 edge_i = vertex_edge_indices[vertex_i * vertex_edge_n + i];
-                    if (!contains(edge_path, edge_i)) {
-                        edge_path.insert(edge_i);
-                        const Edge& edge = mesh.edges[edge_i];
-                        u32 other_vertex_i = edge.v0 == vertex_i ? edge.v1 : edge.v0;
-                        fill_face_set(other_vertex_i);
-                        edge_path.erase(edge_i);
-                    }
-                }
+            Cell& cell = cells[cell_i];
+            if (cell.empty() || cell.back() != face_i) {
+                cell.push_back(face_i);
             }
-        };
+        });
 
-        for (u32 i = 0; i < mesh.vertices.size(); i++) {
-            CHECK_EQ_F(edge_path.size(), (size_t)0);
-            fill_face_set(i);
+        if (!ok) {
+            return false;
         }
+    }
 
-        mesh.faces = std::vector<Face>(face_set.cbegin(), face_set.cend());
-        LOG_F(INFO, "Found %lu faces", mesh.faces.size());
+    if (cells.size() != (size_t)n_cells) {
+        LOG_F(WARNING, "Found %lu cells by hyperplane, expected %i", cells.size(), n_cells);
+        return false;
     }
 
-    // Find cells: for each face, perform a depth-first search on faces
-    // connected by edges, keeping track of the search path as a list of faces.
-    // Add the search path if it is a valid cell -- each edge of the path is
-    // shared by two and only two faces.
-    {
-        // Calculate the number of adjacent faces per face
-        u32 adjacent_faces_n = 0;
-        {
-            const Face& init_face = mesh.faces[0];
-            for (u32 i = 1; i < mesh.faces.size(); i++) {
-                const Face& other_face = mesh.faces[i];
-                for (u32 edge_i : init_face) {
-                    if (contains(other_face, edge_i)) {
-                        adjacent_faces_n++;
-                        break;
-                    }
+    if (!cells_are_closed(mesh, cells)) {
+        LOG_F(WARNING, "Cells found by hyperplane do not form a closed surface");
+        return false;
+    }
+
+    out = std::move(cells);
+    return true;
+}
+
+// Symmetries used to generate faces and cells by orbit: changing the sign of
+// the first coordinate, and the even permutations (0 1 2) and (0 1)(2 3) of
+// the coordinates. Together these generate every sign change and every even
+// permutation, which all of the regular polytopes above except the 5-cell are
+// symmetric under.
+glm::dvec4 apply_symmetry(const s32 symmetry, const glm::dvec4& v) {
+    switch (symmetry) {
+    case 0:
+        return {-v.x, v.y, v.z, v.w};
+    case 1:
+        return {v.z, v.x, v.y, v.w};
+    default:
+        return {v.y, v.x, v.w, v.z};
+    }
+}
+
+constexpr s32 n_symmetries = 3;
+
+// Elements of one rank (faces or cells) generated by orbit, with their images
+// under each symmetry.
+struct OrbitElements {
+    std::vector<std::vector<u32>> elements;
+    std::unordered_map<std::vector<u32>, u32, SortedIndicesHash> index;
+
+    // Add `element` (sorted indices of the rank below) and every image of it
+    // under the symmetries, given the action `lower_action[i * n_symmetries +
+    // s]` of symmetry `s` on index `i` of the rank below. Returns the number
+    // of elements added.
+    size_t add_orbit(std::vector<u32> element, const std::vector<u32>& lower_action) {
+        const size_t first = elements.size();
+        if (!index.emplace(element, (u32)first).second) {
+            return 0;
+        }
+        elements.push_back(std::move(element));
+
+        std::vector<u32> image;
+        for (size_t i = first; i < elements.size(); i++) {
+            for (s32 s = 0; s < n_symmetries; s++) {
+                image.clear();
+                for (u32 lower : elements[i]) {
+                    image.push_back(lower_action[lower * n_symmetries + (u32)s]);
+                }
+                std::sort(image.begin(), image.end());
+
+                if (index.emplace(image, (u32)elements.size()).second) {
+                    elements.push_back(image);
                 }
             }
         }
 
-        // Calculate all adjacent faces
-        std::vector<u32> adjacent_faces;
-        adjacent_faces.reserve(mesh.faces.size() * adjacent_faces_n);
+        return elements.size() - first;
+    }
 
-        for (u32 i = 0; i < mesh.faces.size(); i++) {
-            const Face& current_face = mesh.faces[i];
-            for (u32 other_i = 0; other_i < mesh.faces.size(); other_i++) {
-                if (other_i != i) {
-                    const Face& other_face = mesh.faces[other_i];
-                    for (u32 edge_i : current_face) {
-                        if (contains(other_face, edge_i)) {
-                            adjacent_faces.push_back(other_i);
-                            break;
-                        }
-                    }
+    // The action of each symmetry on these elements, in the same layout as
+    // `lower_action`.
+    std::vector<u32> action(const std::vector<u32>& lower_action) const {
+        std::vector<u32> result(elements.size() * n_symmetries);
+        std::vector<u32> image;
+        for (size_t i = 0; i < elements.size(); i++) {
+            for (s32 s = 0; s < n_symmetries; s++) {
+                image.clear();
+                for (u32 lower : elements[i]) {
+                    image.push_back(lower_action[lower * n_symmetries + (u32)s]);
                 }
+                std::sort(image.begin(), image.end());
+                result[i * n_symmetries + (size_t)s] = index.at(image);
             }
         }
+        return result;
+    }
+};
 
-        CHECK_EQ_F(adjacent_faces.size(), mesh.faces.size() * adjacent_faces_n);
+// Find the faces and cells of a convex polytope by symmetry. Only one face per
+// orbit of vertices is searched for, and only the cells around one face per
+// orbit of faces; the rest are images of those under the symmetries. Returns
+// false if the polytope is not symmetric under the symmetries or the cells
+// found are not a valid set of `n_cells` cells.
+bool generate_by_symmetry(Mesh4& mesh, const f64 edge_length, const s32 edges_per_face, const s32 n_cells) {
 
-        // Collect vertex indices of all faces
-        std::vector<u32> face_vertex_indices;
-        const s32 vertices_per_face = edges_per_face;
-        face_vertex_indices.reserve(mesh.faces.size() * (size_t)vertices_per_face);
+    // The action of each symmetry on vertices and edges.
+    std::vector<u32> vertex_action(mesh.vertices.size() * n_symmetries);
+    {
+        PointIndex4 vertex_index;
+        for (u32 v = 0; v < mesh.vertices.size(); v++) {
+            vertex_index.insert(mesh.vertices[v], v);
+        }
 
-        for (const auto& face : mesh.faces) {
-            std::unordered_set<u32> seen_vertex_indices;
-            for (u32 edge_i : face) {
-                const Edge& edge = mesh.edges[edge_i];
-                if (seen_vertex_indices.insert(edge.v0).second) {
-                    face_vertex_indices.push_back(edge.v0);
-                }
-                if (seen_vertex_indices.insert(edge.v1).second) {
-                    face_vertex_indices.push_back(edge.v1);
+        for (u32 v = 0; v < mesh.vertices.size(); v++) {
+            for (s32 s = 0; s < n_symmetries; s++) {
+                if (!vertex_index.find(apply_symmetry(s, mesh.vertices[v]), vertex_action[v * n_symmetries + (u32)s])) {
+                    LOG_F(WARNING, "Polytope is not symmetric under sign changes and even permutations");
+                    return false;
                 }
             }
         }
+    }
 
-        DCHECK_EQ_F(face_vertex_indices.size(), mesh.faces.size() * (size_t)vertices_per_face);
+    std::vector<u32> edge_action(mesh.edges.size() * n_symmetries);
+    {
+        std::unordered_map<Edge, u32> edge_index;
+        for (u32 e = 0; e < mesh.edges.size(); e++) {
+            edge_index.emplace(mesh.edges[e], e);
+        }
 
-        // Returns true if the given faces share a vertex.
-        const auto share_vertex = [&](u32 face_i1, u32 face_i2) -> bool {
-            for (u32 vii1 = 0; vii1 < (u32)vertices_per_face; vii1++) {
-                u32 vi1 = face_vertex_indices[face_i1 * (u32)vertices_per_face + vii1];
+        for (u32 e = 0; e < mesh.edges.size(); e++) {
+            const Edge& edge = mesh.edges[e];
+            for (u32 s = 0; s < n_symmetries; s++) {
+                const Edge image(vertex_action[edge.v0 * n_symmetries + s], vertex_action[edge.v1 * n_symmetries + s]);
+                edge_action[e * n_symmetries + s] = edge_index.at(image);
+            }
+        }
+    }
 
-                for (u32 vii2 = 0; vii2 < (u32)vertices_per_face; vii2++) {
-                    u32 vi2 = face_vertex_indices[face_i2 * (u32)vertices_per_face + vii2];
+    // Faces: search for the cycles through one vertex of each vertex orbit.
+    OrbitElements faces;
+    {
+        const VertexAdjacency adjacency(mesh.vertices.size(), mesh.edges);
+        std::vector<bool> vertex_done(mesh.vertices.size(), false);
+        std::vector<u32> vertex_orbit;
 
-                    if (vi2 == vi1) {
-                        return true;
-                    }
-                }
+        for (u32 v = 0; v < mesh.vertices.size(); v++) {
+            if (vertex_done[v]) {
+                continue;
             }
 
-            return false;
-        };
-
-        std::mutex cell_set_mutex;
-        std::unordered_set<Cell, CellHash, CellEquals> cell_set;
+            for_each_cycle(adjacency, v, (u32)edges_per_face, false, [&](const u32* cycle) {
+                std::vector<u32> face(cycle, cycle + edges_per_face);
+                std::sort(face.begin(), face.end());
+                faces.add_orbit(std::move(face), edge_action);
+            });
 
-        u32 n_threads = std::thread::hardware_concurrency();
-        if (n_threads == 0) {
-            n_threads = 1;
-        } else if (n_threads > mesh.faces.size()) {
-            n_threads = (u32)mesh.faces.size();
+            vertex_done[v] = true;
+            vertex_orbit.assign(1, v);
+            for (size_t i = 0; i < vertex_orbit.size(); i++) {
+                for (u32 s = 0; s < n_symmetries; s++) {
+                    const u32 image = vertex_action[vertex_orbit[i] * n_symmetries + s];
+                    if (!vertex_done[image]) {
+                        vertex_done[image] = true;
+                        vertex_orbit.push_back(image);
+                    }
+                }
+            }
         }
 
-        u32 search_n = (u32)mesh.faces.size() / n_threads;
-        std::vector<std::thread> threads;
+        mesh.faces = faces.elements;
+        LOG_F(INFO, "Found %lu faces", mesh.faces.size());
+    }
 
-        LOG_F(INFO, "Starting %u threads for cell search", n_threads);
-        for (u32 i = 0; i < n_threads; i++) {
+    // Cells: find the cells around each face that is not yet in two cells, by
+    // collecting the connected faces that lie in each of its supporting
+    // hyperplanes.
+    OrbitElements cells;
+    {
+        const std::vector<u32> face_action = faces.action(edge_action);
+        const ConvexCellPlanes planes(mesh, edge_length);
 
-            u32 search_start = search_n * i;
-            u32 search_end = i == n_threads - 1 ? (u32)mesh.faces.size() : search_start + search_n;
+        std::vector<u8> face_cell_count(mesh.faces.size(), 0);
+        std::vector<u32> cell;
+        std::vector<u32> stack;
 
-            auto t = std::thread([&, i, search_start, search_end]() {
-                loguru::set_thread_name(loguru::textprintf("cell_search%u", i).c_str());
+        for (u32 face_i = 0; face_i < mesh.faces.size(); face_i++) {
+            if (face_cell_count[face_i] >= 2) {
+                continue;
+            }
 
-                std::unordered_map<u32, s32> edges_count;
-                const auto cell_is_valid = [&](const std::unordered_set<u32>& cell) -> bool {
-                    edges_count.clear();
+            const bool ok = planes.for_each_plane(face_i, [&](const glm::dvec4& normal) {
+                const f64 offset = glm::dot(normal, mesh.vertices[mesh.edges[mesh.faces[face_i][0]].v0]);
+                const auto in_plane = [&](u32 other_i) {
+                    for (u32 edge_i : mesh.faces[other_i]) {
+                        for (u32 v : mesh.edges[edge_i].vertices) {
+                            if (std::abs(glm::dot(normal, mesh.vertices[v]) - offset) > planes.epsilon) {
+                                return false;
+                            }
+                        }
+                    }
+                    return true;
+                };
 
-                    for (u32 face_i : cell) {
-                        const Face& face = mesh.faces[face_i];
-                        for (u32 edge_i : face) {
-                            if (!has_key(edges_count, edge_i)) {
-                                edges_count.emplace(edge_i, 1);
-                            } else {
-                                edges_count[edge_i] += 1;
-                                if (edges_count[edge_i] > 2) {
-                                    return false;
-                                }
+                cell.assign(1, face_i);
+                stack.assign(1, face_i);
+                while (!stack.empty()) {
+                    const u32 current = stack.back();
+                    stack.pop_back();
+                    for (u32 edge_i : mesh.faces[current]) {
+                        for (u32 i = planes.edge_faces_start[edge_i]; i < planes.edge_faces_start[edge_i + 1]; i++) {
+                            const u32 other_i = planes.edge_faces[i];
+                            if (!contains(cell, other_i) && in_plane(other_i)) {
+                                cell.push_back(other_i);
+                                stack.push_back(other_i);
                             }
                         }
                     }
+                }
 
-                    for (const auto& entry : edges_count) {
-                        if (entry.second != 2) {
-                            return false;
+                std::sort(cell.begin(), cell.end());
+                const size_t first = cells.elements.size();
+                if (cells.add_orbit(cell, face_action) > 0) {
+                    for (size_t i = first; i < cells.elements.size(); i++) {
+                        for (u32 f : cells.elements[i]) {
+                            face_cell_count[f]++;
                         }
                     }
+                }
+            });
+
+            if (!ok) {
+                return false;
+            }
+        }
+    }
+
+    if (cells.elements.size() != (size_t)n_cells) {
+        LOG_F(WARNING, "Found %lu cells by symmetry, expected %i", cells.elements.size(), n_cells);
+        return false;
+    }
+
+    mesh.cells = std::move(cells.elements);
+    if (!cells_are_closed(mesh, mesh.cells)) {
+        LOG_F(WARNING, "Cells found by symmetry do not form a closed surface");
+        return false;
+    }
+
+    return true;
+}
+
+// Find cells: for each face, perform a depth-first search on faces
+// connected by edges, keeping track of the search path as a list of faces.
+// Add the search path if it is a valid cell -- each edge of the path is
+// shared by two and only two faces.
+std::vector<Cell> find_cells_dfs(const Mesh4& mesh, const s32 edges_per_face, const s32 faces_per_cell,
+                                 const s32 n_cells, GenerateProgress* progress) {
+    // Calculate the number of adjacent faces per face
+    u32 adjacent_faces_n = 0;
+    {
+        const Face& init_face = mesh.faces[0];
+        for (u32 i = 1; i < mesh.faces.size(); i++) {
+            const Face& other_face = mesh.faces[i];
+            for (u32 edge_i : init_face) {
+                if (contains(other_face, edge_i)) {
+                    adjacent_faces_n++;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Calculate all adjacent faces
+    std::vector<u32> adjacent_faces;
+    adjacent_faces.reserve(mesh.faces.size() * adjacent_faces_n);
+
+    for (u32 i = 0; i < mesh.faces.size(); i++) {
+        const Face& current_face = mesh.faces[i];
+        for (u32 other_i = 0; other_i < mesh.faces.size(); other_i++) {
+            if (other_i != i) {
+                const Face& other_face = mesh.faces[other_i];
+                for (u32 edge_i : current_face) {
+                    if (contains(other_face, edge_i)) {
+                        adjacent_faces.push_back(other_i);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    CHECK_EQ_F(adjacent_faces.size(), mesh.faces.size() * adjacent_faces_n);
+
+    // Collect vertex indices of all faces
+    std::vector<u32> face_vertex_indices;
+    const s32 vertices_per_face = edges_per_face;
+    face_vertex_indices.reserve(mesh.faces.size() * (size_t)vertices_per_face);
+
+    for (const auto& face : mesh.faces) {
+        std::unordered_set<u32> seen_vertex_indices;
+        for (u32 edge_i : face) {
+            const Edge& edge = mesh.edges[edge_i];
+            if (seen_vertex_indices.insert(edge.v0).second) {
+                face_vertex_indices.push_back(edge.v0);
+            }
+            if (seen_vertex_indices.insert(edge.v1).second) {
+                face_vertex_indices.push_back(edge.v1);
+            }
+        }
+    }
+
+    DCHECK_EQ_F(face_vertex_indices.size(), mesh.faces.size() * (size_t)vertices_per_face);
 
+    // Returns true if the given faces share a vertex.
+    const auto share_vertex = [&](u32 face_i1, u32 face_i2) -> bool {
+        for (u32 vii1 = 0; vii1 < (u32)vertices_per_face; vii1++) {
+            u32 vi1 = face_vertex_indices[face_i1 * (u32)vertices_per_face + vii1];
+
+            for (u32 vii2 = 0; vii2 < (u32)vertices_per_face; vii2++) {
+                u32 vi2 = face_vertex_indices[face_i2 * (u32)vertices_per_face + vii2];
+
+                if (vi2 == vi1) {
                     return true;
-                };
+                }
+            }
+        }
 
-                std::unordered_set<u32> face_path;
+        return false;
+    };
 
-                // Recursive lambda definition
-                std::function<void(s64, s64, u32)> fill_cell_set;
-                fill_cell_set = [&](s64 parent_face_i, s64 gparent_face_i, u32 face_i) {
-                    DCHECK_F(!contains(face_path, face_i));
-                    face_path.insert(face_i);
-                    DCHECK_F(face_path.size() <= (size_t)faces_per_cell);
+    // Cells are stored with their face indices sorted, so that the same
+    // cell found from different seed faces compares equal.
+    ShardedSet<Cell, SortedIndicesHash> cell_set;
+    std::atomic<u32> n_found_cells = 0;
 
-                    // TODO: Check if current face_path is convex
+    // Per-thread search state.
+    struct CellSearch {
+        std::unordered_map<u32, s32> edges_count;
+        std::unordered_set<u32> face_path;
+    };
 
-                    if (face_path.size() == (size_t)faces_per_cell) {
-                        if (cell_is_valid(face_path)) {
+    const u32 n_workers = hardware_threads();
+    std::vector<CellSearch> searches(n_workers);
 
-                            bool success;
-                            size_t cell_set_size;
-                            {
-                                auto lock = std::scoped_lock(cell_set_mutex);
-                                success = cell_set.emplace(face_path.cbegin(), face_path.cend()).second;
-                                if (success) {
-                                    cell_set_size = cell_set.size();
-                                }
-                            }
+    LOG_F(INFO, "Starting %u threads for cell search", std::min(n_workers, (u32)mesh.faces.size()));
+    parallel_for("cell_search", (u32)mesh.faces.size(), n_workers, [&](u32 seed_face_i, u32 worker) {
+        if (n_found_cells.load(std::memory_order_relaxed) >= (u32)n_cells || (progress && progress->cancelled())) {
+            return;
+        }
 
-                            if (success) {
-                                LOG_F(INFO, "Current cells found: %lu", cell_set_size);
-                            }
-                        }
-                    } else {
-                        for (u32 adj_i = 0; adj_i < adjacent_faces_n; adj_i++) {
-                            u32 adj_face_i = adjacent_faces[face_i * adjacent_faces_n + adj_i];
+        auto& edges_count = searches[worker].edges_count;
+        auto& face_path = searches[worker].face_path;
 
-                            if (!contains(face_path, adj_face_i)
-                                && (parent_face_i == -1 || share_vertex(adj_face_i, (u32)parent_face_i)
-                                    || (gparent_face_i != -1 && share_vertex(adj_face_i, (u32)gparent_face_i)))) {
+        const auto cell_is_valid = [&](const std::unordered_set<u32>& cell) -> bool {
+            edges_count.clear();
 
-                                fill_cell_set(face_i, parent_face_i, adj_face_i);
-                            }
+            for (u32 face_i : cell) {
+                const Face& face = mesh.faces[face_i];
+                for (u32 edge_i : face) {
+                    if (!has_key(edges_count, edge_i)) {
+                        edges_count.emplace(edge_i, 1);
+                    } else {
+                        edges_count[edge_i] += 1;
+                        if (edges_count[edge_i] > 2) {
+                            return false;
                         }
                     }
+                }
+            }
 
-                    const size_t result = face_path.erase(face_i);
-                    DCHECK_EQ_F(result, 1u);
-                };
+            for (const auto& entry : edges_count) {
+                if (entry.second != 2) {
+                    return false;
+                }
+            }
 
-                for (u32 i = search_start; i < search_end; i++) {
-                    LOG_F(INFO, "Searching for cells at face %i ...", i);
-                    face_path.clear();
-                    fill_cell_set(-1, -1, i);
+            return true;
+        };
 
-                    size_t cell_set_size;
-                    {
-                        auto lock = std::scoped_lock(cell_set_mutex);
-                        cell_set_size = cell_set.size();
+        // Recursive lambda definition
+        std::function<void(s64, s64, u32)> fill_cell_set;
+        fill_cell_set = [&](s64 parent_face_i, s64 gparent_face_i, u32 face_i) {
+            DCHECK_F(!contains(face_path, face_i));
+            face_path.insert(face_i);
+            DCHECK_F(face_path.size() <= (size_t)faces_per_cell);
+
+            // TODO: Check if current face_path is convex
+
+            if (face_path.size() == (size_t)faces_per_cell) {
+                if (cell_is_valid(face_path)) {
+                    Cell cell(face_path.cbegin(), face_path.cend());
+                    std::sort(cell.begin(), cell.end());
+
+                    if (cell_set.insert(std::move(cell))) {
+                        const u32 n_found = n_found_cells.fetch_add(1, std::memory_order_relaxed) + 1;
+                        LOG_F(INFO, "Current cells found: %u", n_found);
+                        if (progress) {
+                            progress->n_cells = n_found;
+                        }
                     }
+                }
+            } else {
+                for (u32 adj_i = 0; adj_i < adjacent_faces_n; adj_i++) {
+                    u32 adj_face_i = adjacent_faces[face_i * adjacent_faces_n + adj_i];
 
-                    if (cell_set_size == (size_t)n_cells) {
-                        break;
+                    if (!contains(face_path, adj_face_i)
+                        && (parent_face_i == -1 || share_vertex(adj_face_i, (u32)parent_face_i)
+                            || (gparent_face_i != -1 && share_vertex(adj_face_i, (u32)gparent_face_i)))) {
+
+                        fill_cell_set(face_i, parent_face_i, adj_face_i);
                     }
                 }
-            });
+            }
 
-            threads.push_back(std::move(t));
+            const size_t result = face_path.erase(face_i);
+            DCHECK_EQ_F(result, 1u);
+        };
+
+        LOG_F(INFO, "Searching for cells at face %u ...", seed_face_i);
+        face_path.clear();
+        fill_cell_set(-1, -1, seed_face_i);
+    });
+
+    return cell_set.take();
+}
+
+// Find the faces and cells of a regular convex 4-polytope whose vertices and
+// edges are already in `mesh`.
+Mesh4 complete_mesh4(Mesh4 mesh, const f64 edge_length, const s32 edges_per_face, const s32 faces_per_cell,
+                     const s32 n_cells, const GenerateOptions& options) {
+    CHECK_LE_F(edges_per_face, max_edges_per_face);
+
+    CellSearch cell_search = options.cell_search;
+    if (cell_search == CellSearch::symmetry) {
+        if (options.progress) {
+            options.progress->stage = GenerateProgress::Stage::faces;
         }
 
-        for (auto& t : threads) {
-            t.join();
+        if (generate_by_symmetry(mesh, edge_length, edges_per_face, n_cells)) {
+            LOG_F(INFO, "Total cells found: %lu", mesh.cells.size());
+            return mesh;
         }
 
-        mesh.cells = std::vector<Cell>(cell_set.cbegin(), cell_set.cend());
+        LOG_F(WARNING, "Faces and cells could not be found by symmetry; falling back to hyperplanes");
+        mesh.faces.clear();
+        mesh.cells.clear();
+        cell_search = CellSearch::hyperplanes;
+    }
+
+    // Find faces: a face is a simple cycle of `edges_per_face` edges. For each
+    // vertex, perform a depth-first search through higher-indexed vertices for
+    // paths that return to it, so each cycle is only found starting from its
+    // smallest vertex. Of the two directions around the cycle, only the one
+    // whose second vertex is smaller than its last is kept.
+    GenerateProgress* progress = options.progress;
+    if (progress) {
+        progress->stage = GenerateProgress::Stage::faces;
+    }
+
+    mesh.faces = find_faces(mesh.vertices.size(), mesh.edges, (u32)edges_per_face, progress);
+    LOG_F(INFO, "Found %lu faces", mesh.faces.size());
+
+    if (progress) {
+        if (progress->cancelled()) {
+            return mesh;
+        }
+        progress->n_faces = (u32)mesh.faces.size();
+        progress->stage = GenerateProgress::Stage::cells;
+    }
+
+    // Find cells
+    {
+        bool found = false;
+        if (cell_search == CellSearch::hyperplanes) {
+            found = find_cells_by_hyperplane(mesh, edge_length, n_cells, mesh.cells);
+            if (!found) {
+                LOG_F(WARNING, "Cells could not be found by hyperplane; falling back to depth-first search");
+            }
+        }
+
+        if (!found) {
+            mesh.cells = find_cells_dfs(mesh, edges_per_face, faces_per_cell, n_cells, progress);
+        }
         LOG_F(INFO, "Total cells found: %lu", mesh.cells.size());
     }
 
     return mesh;
 }
+
+// Generate a regular convex 4-polytope.
+Mesh4 generate_mesh4(const glm::dvec4* vertices, const u32 n_vertices, const f64 edge_length, const s32 edges_per_face,
+                     const s32 faces_per_cell, const s32 n_cells, const GenerateOptions& options) {
+    Mesh4 mesh;
+
+    mesh.vertices = std::vector<glm::dvec4>(vertices, vertices + n_vertices);
+    LOG_F(INFO, "%lu vertices", mesh.vertices.size());
+
+    // Find edges: each pair of vertices that are `edge_length` apart makes up
+    // an edge.
+    if (options.progress) {
+        options.progress->stage = GenerateProgress::Stage::edges;
+    }
+    mesh.edges = find_edges(mesh.vertices, edge_length,
+                            [&](u32, u32, f64 dist_sq) { return float_eq(sqrt(dist_sq), edge_length); });
+    LOG_F(INFO, "Found %lu edges", mesh.edges.size());
+
+    if (options.progress) {
+        if (options.progress->cancelled()) {
+            return mesh;
+        }
+        options.progress->n_edges = (u32)mesh.edges.size();
+    }
+
+    return complete_mesh4(std::move(mesh), edge_length, edges_per_face, faces_per_cell, n_cells, options);
+}
+
+// Generate a regular convex 4-polytope with vertices in Q(√5). Edges are found
+// by comparing squared distances exactly with `edge_length_sq`.
+Mesh4 generate_mesh4(const QVec4* vertices, const u32 n_vertices, const QSqrt5 edge_length_sq,
+                     const s32 edges_per_face, const s32 faces_per_cell, const s32 n_cells,
+                     const GenerateOptions& options) {
+    Mesh4 mesh;
+
+    mesh.vertices.reserve(n_vertices);
+    for (u32 i = 0; i < n_vertices; i++) {
+        mesh.vertices.push_back(vertices[i].to_dvec4());
+    }
+    LOG_F(INFO, "%lu vertices", mesh.vertices.size());
+
+    const f64 edge_length = sqrt(edge_length_sq.to_f64());
+    if (options.progress) {
+        options.progress->stage = GenerateProgress::Stage::edges;
+    }
+    mesh.edges = find_edges(mesh.vertices, edge_length, [&](u32 i, u32 j, f64) {
+        return length_sq(vertices[j] - vertices[i]) == edge_length_sq;
+    });
+    LOG_F(INFO, "Found %lu edges", mesh.edges.size());
+
+    if (options.progress) {
+        if (options.progress->cancelled()) {
+            return mesh;
+        }
+        options.progress->n_edges = (u32)mesh.edges.size();
+    }
+
+    return complete_mesh4(std::move(mesh), edge_length, edges_per_face, faces_per_cell, n_cells, options);
+}
+
+// Parse `n` comma-separated integers of at least `min` from the start of
+// `str`, setting `end` to the first character after them.
+bool parse_u32_list(const char* str, u32* out, const s32 n, const u32 min, const char*& end) {
+    const char* c = str;
+    for (s32 i = 0; i < n; i++) {
+        if (i > 0) {
+            if (*c != ',') {
+                return false;
+            }
+            c++;
+        }
+
+        char* number_end;
+        const unsigned long value = strtoul(c, &number_end, 10);
+        if (number_end == c || value < min || value > 1000000) {
+            return false;
+        }
+        out[i] = (u32)value;
+        c = number_end;
+    }
+
+    end = c;
+    return true;
+}
+
+// Parse the resolution after the `prefix_length` characters of a surface spec
+// such as "3-sphere:32".
+bool parse_surface_resolution(const char* spec, const size_t prefix_length, u32& out) {
+    const char* end;
+    if (!parse_u32_list(spec + prefix_length, &out, 1, 8, end) || *end != '\0' || out > 128) {
+        LOG_F(ERROR, "Expected \"%.*s<resolution>\" with resolution in [8, 128], got \"%s\"", (s32)prefix_length,
+              spec, spec);
+        return false;
+    }
+    return true;
+}
 } // namespace
 
-Mesh4 generate_5cell() {
+Mesh4 generate_5cell(const GenerateOptions& options) {
     Mesh4 result = generate_mesh4(n5cell_vertices, ARRAY_SIZE(n5cell_vertices), n5cell_edge_length,
-                                  n5cell_edges_per_face, n5cell_faces_per_cell, n5cell_n_cells);
+                                  n5cell_edges_per_face, n5cell_faces_per_cell, n5cell_n_cells, options);
     result.name = "5-cell";
     return result;
 }
 
-Mesh4 generate_tesseract() {
+Mesh4 generate_tesseract(const GenerateOptions& options) {
     Mesh4 result = generate_mesh4(tesseract_vertices, ARRAY_SIZE(tesseract_vertices), tesseract_edge_length,
-                                  tesseract_edges_per_face, tesseract_faces_per_cell, tesseract_n_cells);
+                                  tesseract_edges_per_face, tesseract_faces_per_cell, tesseract_n_cells, options);
     result.name = "Tesseract";
     return result;
 }
 
-Mesh4 generate_16cell() {
+Mesh4 generate_16cell(const GenerateOptions& options) {
     Mesh4 result = generate_mesh4(n16cell_vertices, ARRAY_SIZE(n16cell_vertices), n16cell_edge_length,
-                                  n16cell_edges_per_face, n16cell_faces_per_cell, n16cell_n_cells);
+                                  n16cell_edges_per_face, n16cell_faces_per_cell, n16cell_n_cells, options);
     result.name = "16-cell";
     return result;
 }
 
-Mesh4 generate_24cell() {
-    Mesh4 result = generate_mesh4(n24cell_vertices, ARRAY_SIZE(n24cell_vertices), n24cell_edge_length,
-                                  n24cell_edges_per_face, n24cell_faces_per_cell, n24cell_n_cells);
+Mesh4 generate_24cell(const GenerateOptions& options) {
+    Mesh4 result = generate_mesh4(n24cell_vertices, ARRAY_SIZE(n24cell_vertices), n24cell_edge_length_sq,
+                                  n24cell_edges_per_face, n24cell_faces_per_cell, n24cell_n_cells, options);
     result.name = "24-cell";
     return result;
 }
 
-Mesh4 generate_120cell() {
-    const std::vector<glm::dvec4> n120cell_vertices = generate_120cell_vertices();
-    Mesh4 result = generate_mesh4(n120cell_vertices.data(), (u32)n120cell_vertices.size(), n120cell_edge_length,
-                                  n120cell_edges_per_face, n120cell_faces_per_cell, n120cell_n_cells);
+Mesh4 generate_120cell(const GenerateOptions& options) {
+    const std::vector<QVec4> n120cell_vertices = generate_120cell_vertices();
+    Mesh4 result = generate_mesh4(n120cell_vertices.data(), (u32)n120cell_vertices.size(), n120cell_edge_length_sq,
+                                  n120cell_edges_per_face, n120cell_faces_per_cell, n120cell_n_cells, options);
     result.name = "120-cell";
     return result;
 }
 
-Mesh4 generate_600cell() {
-    const std::vector<glm::dvec4> n600cell_vertices = generate_600cell_vertices();
-    Mesh4 result = generate_mesh4(n600cell_vertices.data(), (u32)n600cell_vertices.size(), n600cell_edge_length,
-                                  n600cell_edges_per_face, n600cell_faces_per_cell, n600cell_n_cells);
+Mesh4 generate_600cell(const GenerateOptions& options) {
+    const std::vector<QVec4> n600cell_vertices = generate_600cell_vertices();
+    Mesh4 result = generate_mesh4(n600cell_vertices.data(), (u32)n600cell_vertices.size(), n600cell_edge_length_sq,
+                                  n600cell_edges_per_face, n600cell_faces_per_cell, n600cell_n_cells, options);
     result.name = "600-cell";
     return result;
 }
+
+bool generate_from_spec(const char* spec, const GenerateOptions& options, Mesh4& out) {
+    if (c_str_eq(spec, "5-cell")) {
+        out = generate_5cell(options);
+
+    } else if (c_str_eq(spec, "Tesseract")) {
+        out = generate_tesseract(options);
+
+    } else if (c_str_eq(spec, "16-cell")) {
+        out = generate_16cell(options);
+
+    } else if (c_str_eq(spec, "24-cell")) {
+        out = generate_24cell(options);
+
+    } else if (c_str_eq(spec, "120-cell")) {
+        out = generate_120cell(options);
+
+    } else if (c_str_eq(spec, "600-cell")) {
+        out = generate_600cell(options);
+
+    } else if (strncmp(spec, "coxeter:", 8) == 0) {
+        CoxeterDiagram diagram;
+        if (!parse_coxeter_diagram(spec + 8, diagram)) {
+            return false;
+        }
+        out = generate_wythoff(diagram, options.progress);
+
+    } else if (strncmp(spec, "duoprism:", 9) == 0) {
+        u32 pq[2];
+        const char* end;
+        if (!parse_u32_list(spec + 9, pq, 2, 3, end) || *end != '\0') {
+            LOG_F(ERROR, "Expected \"duoprism:<p>,<q>\" with p, q >= 3, got \"%s\"", spec);
+            return false;
+        }
+        if ((u64)pq[0] * pq[1] > (1u << 24)) {
+            LOG_F(ERROR, "Duoprism \"%s\" has too many vertices", spec);
+            return false;
+        }
+        out = generate_duoprism(pq[0], pq[1], options.progress);
+
+    } else if (strncmp(spec, "prism:", 6) == 0) {
+        u32 pq[2];
+        const char* end;
+        bool rings[3] = {true, false, false};
+        bool valid = parse_u32_list(spec + 6, pq, 2, 2, end);
+        if (valid && *end == ':') {
+            end++;
+            for (s32 i = 0; i < 3 && valid; i++) {
+                valid = end[i] == '0' || end[i] == '1';
+                rings[i] = end[i] == '1';
+            }
+            end += valid ? 3 : 0;
+        }
+        if (!valid || *end != '\0') {
+            LOG_F(ERROR, "Expected \"prism:<p>,<q>[:<rings>]\", got \"%s\"", spec);
+            return false;
+        }
+
+        // Validate the diagram of the prism before generating it.
+        CoxeterDiagram diagram;
+        const auto diagram_spec = strprintf("%u,%u,2:%i%i%i1", pq[0], pq[1], rings[0], rings[1], rings[2]);
+        if (!parse_coxeter_diagram(diagram_spec.c_str(), diagram)) {
+            return false;
+        }
+        out = generate_polyhedral_prism((s32)pq[0], (s32)pq[1], rings, options.progress);
+
+    } else if (strncmp(spec, "antiprism-prism:", 16) == 0) {
+        u32 p;
+        const char* end;
+        if (!parse_u32_list(spec + 16, &p, 1, 3, end) || *end != '\0') {
+            LOG_F(ERROR, "Expected \"antiprism-prism:<p>\" with p >= 3, got \"%s\"", spec);
+            return false;
+        }
+        out = generate_antiprismatic_prism(p, options.progress);
+
+    } else if (strncmp(spec, "3-sphere:", 9) == 0) {
+        u32 resolution;
+        if (!parse_surface_resolution(spec, 9, resolution)) {
+            return false;
+        }
+        out = generate_3sphere(resolution, options.progress);
+
+    } else if (strncmp(spec, "clifford-torus:", 15) == 0) {
+        u32 resolution;
+        if (!parse_surface_resolution(spec, 15, resolution)) {
+            return false;
+        }
+        out = generate_clifford_torus(resolution, options.progress);
+
+    } else if (strncmp(spec, "spherinder:", 11) == 0) {
+        u32 resolution;
+        if (!parse_surface_resolution(spec, 11, resolution)) {
+            return false;
+        }
+        out = generate_spherinder(resolution, options.progress);
+
+    } else if (strncmp(spec, "cubinder:", 9) == 0) {
+        u32 resolution;
+        if (!parse_surface_resolution(spec, 9, resolution)) {
+            return false;
+        }
+        out = generate_cubinder(resolution, options.progress);
+
+    } else if (strncmp(spec, "dual:", 5) == 0) {
+        Mesh4 mesh;
+        if (!generate_from_spec(spec + 5, options, mesh) || !dual(mesh, out, options.progress)) {
+            return false;
+        }
+
+    } else if (strncmp(spec, "truncate:", 9) == 0) {
+        Mesh4 mesh;
+        if (!generate_from_spec(spec + 9, options, mesh) || !truncate(mesh, out, options.progress)) {
+            return false;
+        }
+
+    } else if (strncmp(spec, "rectify:", 8) == 0) {
+        Mesh4 mesh;
+        if (!generate_from_spec(spec + 8, options, mesh) || !rectify(mesh, out, options.progress)) {
+            return false;
+        }
+
+    } else if (strncmp(spec, "bitruncate:", 11) == 0) {
+        Mesh4 mesh;
+        if (!generate_from_spec(spec + 11, options, mesh) || !bitruncate(mesh, out, options.progress)) {
+            return false;
+        }
+
+    } else if (strncmp(spec, "hull:", 5) == 0) {
+        const char* path = spec + 5;
+        std::vector<glm::dvec4> points;
+        if (!load_points_from_file(path, points) || !convex_hull(points, out, options.progress)) {
+            return false;
+        }
+
+        // Name the mesh after the point file, without directories or extension.
+        const char* name = path;
+        for (const char* c = path; *c != '\0'; c++) {
+            if (*c == '/' || *c == '\\') {
+                name = c + 1;
+            }
+        }
+        const char* extension = strrchr(name, '.');
+        out.name = extension == NULL ? name : std::string(name, (size_t)(extension - name));
+
+    } else {
+        LOG_F(ERROR, "Unknown mesh4 \"%s\"", spec);
+        return false;
+    }
+
+    GenerateProgress* progress = options.progress;
+    if (progress) {
+        if (progress->cancelled()) {
+            LOG_F(INFO, "Generation of mesh4 \"%s\" was cancelled", spec);
+            return false;
+        }
+
+        // Generators that build their topology directly only report it here.
+        progress->n_edges = (u32)out.edges.size();
+        progress->n_faces = (u32)out.faces.size();
+        progress->n_cells = (u32)out.cells.size();
+    }
+
+    return true;
+}
 } // namespace four
@@ -4,11 +4,47 @@
 
 namespace four {
 
-Mesh4 generate_5cell();
-Mesh4 generate_tesseract();
-Mesh4 generate_16cell();
-Mesh4 generate_24cell();
-Mesh4 generate_120cell();
-Mesh4 generate_600cell();
+// How `generate_*` functions find the cells of a polytope from its faces.
+enum class CellSearch {
+
+    // Bucket faces by the supporting hyperplanes they lie in. Only works for
+    // convex polytopes; falls back to `dfs` if no valid cells are found.
+    hyperplanes,
+
+    // Depth-first search over adjacent faces.
+    dfs,
+
+    // Search for one face per orbit of vertices and the cells around one face
+    // per orbit of faces, and generate the rest of the faces and cells by
+    // applying sign changes and even permutations of coordinates. Falls back
+    // to `hyperplanes` if the polytope is not symmetric under these.
+    symmetry,
+};
+
+struct GenerateOptions {
+    CellSearch cell_search = CellSearch::hyperplanes;
+
+    // How the generated mesh is tetrahedralized, by callers that do so.
+    TetMode tet_mode = TetMode::fans;
+
+    // If not null, receives the progress of the generation and can cancel it.
+    // A cancelled generation returns early with an incomplete mesh.
+    GenerateProgress* progress = NULL;
+};
+
+Mesh4 generate_5cell(const GenerateOptions& options = {});
+Mesh4 generate_tesseract(const GenerateOptions& options = {});
+Mesh4 generate_16cell(const GenerateOptions& options = {});
+Mesh4 generate_24cell(const GenerateOptions& options = {});
+Mesh4 generate_120cell(const GenerateOptions& options = {});
+Mesh4 generate_600cell(const GenerateOptions& options = {});
+
+// Generate the mesh named by `spec`: either the name of a regular convex
+// 4-polytope (e.g. "120-cell") or a parametrized family such as
+// "coxeter:5,3,3:1100" or "duoprism:200,300", optionally preceded by
+// operators from operators.hpp such as "dual:" or "truncate:". Returns false
+// and logs an error if `spec` is not recognised or its parameters are invalid,
+// if an operator cannot be applied, or if the generation is cancelled.
+bool generate_from_spec(const char* spec, const GenerateOptions& options, Mesh4& out);
 
 } // namespace four
@@ -0,0 +1,521 @@
+#include <four/hull.hpp>
+
+#include <four/parallel.hpp>
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace four {
+
+namespace {
+
+// Point sets at least this large are partitioned between facets on all cores.
+constexpr size_t parallel_threshold = 1u << 15;
+constexpr u32 parallel_chunk_size = 1u << 12;
+
+constexpr u32 no_point = UINT32_MAX;
+
+// A tetrahedral facet of the hull under construction.
+struct Facet {
+
+    // `neighbours[i]` is the facet sharing every vertex except `vertices[i]`.
+    u32 vertices[4];
+    u32 neighbours[4];
+
+    // Outward unit normal and offset of the facet's hyperplane.
+    glm::dvec4 normal;
+    f64 offset;
+
+    // Points above the facet that are not yet part of the hull.
+    std::vector<u32> outside;
+
+    bool alive;
+    bool visible;
+
+    // The iteration in which `visible` was last calculated.
+    u32 visited;
+};
+
+struct Quickhull {
+    const std::vector<glm::dvec4>& points;
+    const GenerateProgress* progress;
+    f64 epsilon;
+
+    // A point strictly inside the hull, used to orient facets.
+    glm::dvec4 interior;
+
+    std::vector<Facet> facets;
+    std::vector<u32> free_facets;
+
+    Quickhull(const std::vector<glm::dvec4>& points, const GenerateProgress* progress)
+        : points(points), progress(progress), epsilon(0), interior(0, 0, 0, 0) {}
+
+    f64 distance(const Facet& f, u32 point) const {
+        return glm::dot(f.normal, points[point]) - f.offset;
+    }
+
+    u32 new_facet(u32 a, u32 b, u32 c, u32 d) {
+        u32 index;
+        if (free_facets.empty()) {
+            index = (u32)facets.size();
+            facets.emplace_back();
+        } else {
+            index = free_facets.back();
+            free_facets.pop_back();
+        }
+
+        Facet& f = facets[index];
+        f.vertices[0] = a;
+        f.vertices[1] = b;
+        f.vertices[2] = c;
+        f.vertices[3] = d;
+        f.outside.clear();
+        f.alive = true;
+        f.visible = false;
+        f.visited = 0;
+
+        const glm::dvec4 p = points[a];
+        f.normal = cross(points[b] - p, points[c] - p, points[d] - p);
+        const f64 length = glm::length(f.normal);
+        f.normal = length > 0.0 ? f.normal / length : glm::dvec4(0, 0, 0, 0);
+        f.offset = glm::dot(f.normal, p);
+        if (glm::dot(f.normal, interior) > f.offset) {
+            f.normal = -f.normal;
+            f.offset = -f.offset;
+        }
+
+        return index;
+    }
+
+    // Move each of `candidates` to the outside set of the first of
+    // `new_facets` that it is above. Points that are above none of them are
+    // inside the hull and are dropped.
+    void assign_points(const std::vector<u32>& candidates, const std::vector<u32>& new_facets) {
+        const auto find_facet = [&](u32 point) -> u32 {
+            for (u32 facet_i : new_facets) {
+                if (distance(facets[facet_i], point) > epsilon) {
+                    return facet_i;
+                }
+            }
+            return no_point;
+        };
+
+        if (candidates.size() < parallel_threshold) {
+            for (u32 point : candidates) {
+                const u32 facet_i = find_facet(point);
+                if (facet_i != no_point) {
+                    facets[facet_i].outside.push_back(point);
+                }
+            }
+            return;
+        }
+
+        std::vector<u32> targets(candidates.size());
+        const u32 n_chunks = (u32)((candidates.size() + parallel_chunk_size - 1) / parallel_chunk_size);
+        parallel_for("hull", n_chunks, hardware_threads(), [&](u32 chunk, u32) {
+            const size_t end = std::min(candidates.size(), (size_t)(chunk + 1) * parallel_chunk_size);
+            for (size_t i = (size_t)chunk * parallel_chunk_size; i < end; i++) {
+                targets[i] = find_facet(candidates[i]);
+            }
+        });
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (targets[i] != no_point) {
+                facets[targets[i]].outside.push_back(candidates[i]);
+            }
+        }
+    }
+
+    // Find five affinely independent points, each as far as possible from the
+    // span of the ones before it. Returns false if there are none.
+    bool find_initial_simplex(u32 (&simplex)[5]) {
+        simplex[0] = 0;
+        for (u32 i = 1; i < points.size(); i++) {
+            if (points[i].x < points[simplex[0]].x) {
+                simplex[0] = i;
+            }
+        }
+
+        const glm::dvec4 origin = points[simplex[0]];
+        glm::dvec4 basis[3];
+
+        for (u32 dim = 1; dim < 5; dim++) {
+            f64 max_dist = -1.0;
+            glm::dvec4 max_residual = {0, 0, 0, 0};
+
+            for (u32 i = 0; i < points.size(); i++) {
+                glm::dvec4 residual = points[i] - origin;
+                for (u32 b = 0; b < dim - 1; b++) {
+                    residual -= glm::dot(residual, basis[b]) * basis[b];
+                }
+
+                const f64 dist = glm::length(residual);
+                if (dist > max_dist) {
+                    max_dist = dist;
+                    max_residual = residual;
+                    simplex[dim] = i;
+                }
+            }
+
+            if (max_dist <= epsilon) {
+                return false;
+            }
+            if (dim < 4) {
+                basis[dim - 1] = max_residual / max_dist;
+            }
+        }
+
+        return true;
+    }
+
+    // Build the hull. Returns false if the points do not span four dimensions
+    // or `progress` is cancelled.
+    bool run() {
+        f64 scale = 0.0;
+        for (const auto& p : points) {
+            for (s32 i = 0; i < 4; i++) {
+                scale = std::max(scale, std::abs(p[i]));
+            }
+        }
+        epsilon = std::max(scale, 1.0) * 0.000000001;
+
+        u32 simplex[5];
+        if (points.size() < 5 || !find_initial_simplex(simplex)) {
+            return false;
+        }
+
+        for (u32 v : simplex) {
+            interior += points[v];
+        }
+        interior /= 5.0;
+
+        // Facet `k` of the initial simplex omits simplex vertex `k`, so the
+        // neighbour opposite simplex vertex `v` is facet `v`.
+        std::vector<u32> initial_facets;
+        for (u32 k = 0; k < 5; k++) {
+            u32 vertices[4];
+            u32 neighbours[4];
+            for (u32 v = 0, i = 0; v < 5; v++) {
+                if (v != k) {
+                    vertices[i] = simplex[v];
+                    neighbours[i] = v;
+                    i++;
+                }
+            }
+
+            const u32 facet_i = new_facet(vertices[0], vertices[1], vertices[2], vertices[3]);
+            std::copy(neighbours, neighbours + 4, facets[facet_i].neighbours);
+            initial_facets.push_back(facet_i);
+        }
+
+        {
+            std::vector<u32> candidates;
+            candidates.reserve(points.size());
+            for (u32 i = 0; i < points.size(); i++) {
+                if (std::find(simplex, simplex + 5, i) == simplex + 5) {
+                    candidates.push_back(i);
+                }
+            }
+            assign_points(candidates, initial_facets);
+        }
+
+        std::vector<u32> pending = initial_facets;
+        std::vector<u32> visible;
+        std::vector<std::pair<u32, u32>> horizon;
+        std::vector<u32> created;
+        std::vector<u32> candidates;
+        std::unordered_map<Edge, std::pair<u32, u32>> open_ridges;
+        u32 iteration = 0;
+
+        while (!pending.empty()) {
+            if (progress && progress->cancelled()) {
+                return false;
+            }
+            const u32 start = pending.back();
+            pending.pop_back();
+            if (!facets[start].alive || facets[start].outside.empty()) {
+                continue;
+            }
+
+            // The point farthest above the facet is always a hull vertex.
+            u32 apex = no_point;
+            {
+                f64 max_dist = -1.0;
+                for (u32 point : facets[start].outside) {
+                    const f64 dist = distance(facets[start], point);
+                    if (dist > max_dist) {
+                        max_dist = dist;
+                        apex = point;
+                    }
+                }
+            }
+
+            // Find the facets visible from the apex, and the horizon: the
+            // ridges between visible and non-visible facets, as (visible
+            // facet, slot) pairs.
+            iteration++;
+            visible.assign(1, start);
+            horizon.clear();
+            facets[start].visited = iteration;
+            facets[start].visible = true;
+
+            for (size_t i = 0; i < visible.size(); i++) {
+                for (u32 k = 0; k < 4; k++) {
+                    const u32 neighbour_i = facets[visible[i]].neighbours[k];
+                    Facet& neighbour = facets[neighbour_i];
+                    if (neighbour.visited != iteration) {
+                        neighbour.visited = iteration;
+                        neighbour.visible = distance(neighbour, apex) > epsilon;
+                        if (neighbour.visible) {
+                            visible.push_back(neighbour_i);
+                        }
+                    }
+                    if (!neighbour.visible) {
+                        horizon.emplace_back(visible[i], k);
+                    }
+                }
+            }
+
+            // Replace the visible facets with a cone of new facets from the
+            // horizon to the apex.
+            created.clear();
+            open_ridges.clear();
+            for (const auto& [visible_i, k] : horizon) {
+                u32 ridge[3];
+                for (u32 v = 0, i = 0; v < 4; v++) {
+                    if (v != k) {
+                        ridge[i++] = facets[visible_i].vertices[v];
+                    }
+                }
+
+                const u32 beyond_i = facets[visible_i].neighbours[k];
+                const u32 facet_i = new_facet(ridge[0], ridge[1], ridge[2], apex);
+                created.push_back(facet_i);
+
+                facets[facet_i].neighbours[3] = beyond_i;
+                for (u32& n : facets[beyond_i].neighbours) {
+                    if (n == visible_i) {
+                        n = facet_i;
+                    }
+                }
+
+                // The new facets around the apex are joined across the
+                // ridges containing the apex and a horizon edge.
+                for (u32 slot = 0; slot < 3; slot++) {
+                    const Edge edge(ridge[(slot + 1) % 3], ridge[(slot + 2) % 3]);
+                    const auto it = open_ridges.find(edge);
+                    if (it == open_ridges.cend()) {
+                        open_ridges.emplace(edge, std::make_pair(facet_i, slot));
+                    } else {
+                        facets[facet_i].neighbours[slot] = it->second.first;
+                        facets[it->second.first].neighbours[it->second.second] = facet_i;
+                        open_ridges.erase(it);
+                    }
+                }
+            }
+            DCHECK_F(open_ridges.empty());
+
+            candidates.clear();
+            for (u32 facet_i : visible) {
+                Facet& f = facets[facet_i];
+                for (u32 point : f.outside) {
+                    if (point != apex) {
+                        candidates.push_back(point);
+                    }
+                }
+                f.outside.clear();
+                f.outside.shrink_to_fit();
+                f.alive = false;
+                free_facets.push_back(facet_i);
+            }
+
+            assign_points(candidates, created);
+
+            for (u32 facet_i : created) {
+                if (!facets[facet_i].outside.empty()) {
+                    pending.push_back(facet_i);
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+u32 find_root(std::vector<u32>& parents, u32 x) {
+    while (parents[x] != x) {
+        parents[x] = parents[parents[x]];
+        x = parents[x];
+    }
+    return x;
+}
+} // namespace
+
+bool convex_hull(const std::vector<glm::dvec4>& points, Mesh4& out, const GenerateProgress* progress) {
+    Quickhull hull(points, progress);
+    if (!hull.run()) {
+        if (progress && progress->cancelled()) {
+            return false;
+        }
+        LOG_F(ERROR, "Convex hull: the %lu points do not span four dimensions", points.size());
+        return false;
+    }
+
+    const auto& facets = hull.facets;
+
+    // Merge coplanar neighbouring facets into cells.
+    std::vector<u32> parents(facets.size());
+    for (u32 i = 0; i < facets.size(); i++) {
+        parents[i] = i;
+    }
+    for (u32 i = 0; i < facets.size(); i++) {
+        if (!facets[i].alive) {
+            continue;
+        }
+        for (u32 n : facets[i].neighbours) {
+            if (glm::dot(facets[i].normal, facets[n].normal) > 1.0 - 0.0000000001
+                && std::abs(facets[i].offset - facets[n].offset) <= hull.epsilon) {
+                parents[find_root(parents, i)] = find_root(parents, n);
+            }
+        }
+    }
+
+    std::vector<u32> cell_of_facet(facets.size(), UINT32_MAX);
+    u32 n_cells = 0;
+    for (u32 i = 0; i < facets.size(); i++) {
+        if (facets[i].alive) {
+            const u32 root = find_root(parents, i);
+            if (cell_of_facet[root] == UINT32_MAX) {
+                cell_of_facet[root] = n_cells++;
+            }
+            cell_of_facet[i] = cell_of_facet[root];
+        }
+    }
+
+    // Each face is the set of ridges between a pair of cells. Its edges are
+    // the sides of those triangles that are not shared by two of them.
+    std::unordered_map<u64, u32> face_index;
+    std::vector<std::pair<u32, u32>> face_cells;
+    std::vector<std::vector<Edge>> face_sides;
+
+    for (u32 i = 0; i < facets.size(); i++) {
+        const Facet& f = facets[i];
+        if (!f.alive) {
+            continue;
+        }
+
+        for (u32 k = 0; k < 4; k++) {
+            const u32 n = f.neighbours[k];
+            const u32 cell_a = cell_of_facet[i];
+            const u32 cell_b = cell_of_facet[n];
+            if (cell_a >= cell_b) {
+                continue;
+            }
+
+            const u64 key = (u64)cell_a << 32 | cell_b;
+            auto it = face_index.find(key);
+            if (it == face_index.cend()) {
+                it = face_index.emplace(key, (u32)face_cells.size()).first;
+                face_cells.emplace_back(cell_a, cell_b);
+                face_sides.emplace_back();
+            }
+
+            u32 ridge[3];
+            for (u32 v = 0, j = 0; v < 4; v++) {
+                if (v != k) {
+                    ridge[j++] = f.vertices[v];
+                }
+            }
+            auto& sides = face_sides[it->second];
+            sides.emplace_back(ridge[0], ridge[1]);
+            sides.emplace_back(ridge[1], ridge[2]);
+            sides.emplace_back(ridge[2], ridge[0]);
+        }
+    }
+
+    Mesh4 mesh;
+    std::unordered_map<u32, u32> vertex_index;
+    std::unordered_map<Edge, u32> edge_index;
+    std::unordered_map<Edge, s32> side_count;
+
+    const auto add_vertex = [&](u32 point) -> u32 {
+        auto it = vertex_index.find(point);
+        if (it == vertex_index.cend()) {
+            it = vertex_index.emplace(point, (u32)mesh.vertices.size()).first;
+            mesh.vertices.push_back(points[point]);
+        }
+        return it->second;
+    };
+
+    mesh.faces.resize(face_sides.size());
+    for (size_t face_i = 0; face_i < face_sides.size(); face_i++) {
+        side_count.clear();
+        for (const Edge& side : face_sides[face_i]) {
+            side_count[side]++;
+        }
+
+        for (const Edge& side : face_sides[face_i]) {
+            if (side_count.at(side) != 1) {
+                continue;
+            }
+
+            const Edge edge(add_vertex(side.v0), add_vertex(side.v1));
+            auto it = edge_index.find(edge);
+            if (it == edge_index.cend()) {
+                it = edge_index.emplace(edge, (u32)mesh.edges.size()).first;
+                mesh.edges.push_back(edge);
+            }
+            mesh.faces[face_i].push_back(it->second);
+        }
+    }
+
+    mesh.cells.resize(n_cells);
+    for (u32 face_i = 0; face_i < face_cells.size(); face_i++) {
+        mesh.cells[face_cells[face_i].first].push_back(face_i);
+        mesh.cells[face_cells[face_i].second].push_back(face_i);
+    }
+
+    LOG_F(INFO, "Convex hull of %lu points: %lu vertices, %lu edges, %lu faces, %lu cells", points.size(),
+          mesh.vertices.size(), mesh.edges.size(), mesh.faces.size(), mesh.cells.size());
+
+    out = std::move(mesh);
+    return true;
+}
+
+bool load_points_from_file(const char* path, std::vector<glm::dvec4>& out) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        LOG_F(ERROR, "Could not open point file %s", path);
+        return false;
+    }
+
+    std::vector<glm::dvec4> points;
+    glm::dvec4 p;
+    s32 n_read;
+    while ((n_read = fscanf(file, "%lf %lf %lf %lf", &p.x, &p.y, &p.z, &p.w)) == 4) {
+        points.push_back(p);
+    }
+
+    const bool at_end = n_read == EOF && !ferror(file);
+    fclose(file);
+
+    if (!at_end) {
+        LOG_F(ERROR, "Invalid point file %s: expected 4 coordinates per point after point %lu", path,
+              points.size());
+        return false;
+    }
+
+    out = std::move(points);
+    return true;
+}
+
+} // namespace four
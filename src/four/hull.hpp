@@ -0,0 +1,21 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+#include <vector>
+
+namespace four {
+
+// Calculate the convex hull of `points` with the Quickhull algorithm. Each cell
+// of the result is a hull facet, with coplanar simplices merged, and the
+// faces and edges are derived from the cells, so no search is needed. Points
+// that are not vertices of the hull are dropped. Returns false and logs an
+// error if the points do not span four dimensions. If `progress` is given and
+// is cancelled, returns false without logging an error.
+bool convex_hull(const std::vector<glm::dvec4>& points, Mesh4& out, const GenerateProgress* progress = NULL);
+
+// Read a point cloud from a text file of whitespace-separated coordinates, four
+// per point. Returns false and logs an error if the file cannot be read.
+bool load_points_from_file(const char* path, std::vector<glm::dvec4>& out);
+
+} // namespace four
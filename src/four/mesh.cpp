@@ -1,16 +1,20 @@
 #include <four/mesh.hpp>
 
+#include <four/mesh_binary.hpp>
+#include <four/mesh_xml.hpp>
+#include <four/parallel.hpp>
+#include <four/point_index.hpp>
+
 #include <loguru.hpp>
 #include <tetgen.h>
-#include <tinyxml2.h>
 
 #include <algorithm>
+#include <chrono>
+#include <map>
 #include <string.h>
 #include <string>
 #include <utility>
 
-namespace txml = tinyxml2;
-
 namespace four {
 
 namespace {
@@ -44,7 +48,8 @@ void tetrahedralize_polyhedron(const std::vector<glm::dvec3>& vertices, const st
         }
     }
 
-    char switches[] = "pYzFQ";
+    char switches[sizeof(tetgen_switches)];
+    memcpy(switches, tetgen_switches, sizeof(switches));
     tetgenio tetgen_out;
     try {
         ::tetrahedralize(switches, &tetgen_in, &tetgen_out);
@@ -70,12 +75,515 @@ void tetrahedralize_polyhedron(const std::vector<glm::dvec3>& vertices, const st
     }
 }
 
-void tetrahedralize_cell(const Mesh4& mesh, const s64 cell_i, std::vector<glm::dvec4>& out_vertices,
+// Find the vertices of face `f` in order around it. Returns false if its
+// edges do not form a single closed loop.
+bool trace_face(const Mesh4& mesh, const Face& f, std::vector<u32>& out) {
+    out.clear();
+    out.reserve(f.size());
+
+    const Edge& e0 = mesh.edges[f[0]];
+    const u32 first_vi = e0.v0;
+    out.push_back(first_vi);
+
+    u32 prev_edge_i = f[0];
+    u32 next_vi = e0.v1;
+
+    while (next_vi != first_vi) {
+        if (out.size() >= f.size()) {
+            return false;
+        }
+
+        bool found = false;
+        for (u32 e_i : f) {
+            if (e_i != prev_edge_i) {
+                const Edge& e = mesh.edges[e_i];
+                if (e.v0 == next_vi || e.v1 == next_vi) {
+                    out.push_back(next_vi);
+                    next_vi = e.v0 == next_vi ? e.v1 : e.v0;
+                    prev_edge_i = e_i;
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    return out.size() == f.size();
+}
+
+// A cell's vertices, sorted, and each of its faces as a loop of them.
+struct CellShape {
+    std::vector<u32> vertices;
+    std::vector<std::vector<u32>> faces;
+    glm::dvec4 centroid;
+
+    // The greatest distance of a vertex from the centroid.
+    f64 size;
+
+    // The distances of the vertices from the centroid, sorted. Like the
+    // numbers of vertices and faces, these are the same for congruent cells.
+    std::vector<f64> radii;
+};
+
+// Returns false if a face of the cell is not a single loop.
+bool trace_cell(const Mesh4& mesh, const u32 cell_i, CellShape& out) {
+    const Cell& cell = mesh.cells[cell_i];
+
+    out.vertices.clear();
+    out.faces.resize(cell.size());
+    for (size_t i = 0; i < cell.size(); i++) {
+        if (!trace_face(mesh, mesh.faces[cell[i]], out.faces[i])) {
+            return false;
+        }
+        out.vertices.insert(out.vertices.end(), out.faces[i].begin(), out.faces[i].end());
+    }
+    std::sort(out.vertices.begin(), out.vertices.end());
+    out.vertices.erase(std::unique(out.vertices.begin(), out.vertices.end()), out.vertices.end());
+
+    out.centroid = glm::dvec4(0, 0, 0, 0);
+    for (u32 v_i : out.vertices) {
+        out.centroid += mesh.vertices[v_i];
+    }
+    out.centroid /= (f64)out.vertices.size();
+
+    out.radii.clear();
+    for (u32 v_i : out.vertices) {
+        out.radii.push_back(glm::length(mesh.vertices[v_i] - out.centroid));
+    }
+    std::sort(out.radii.begin(), out.radii.end());
+    out.size = out.radii.back();
+    return true;
+}
+
+// The unit normal of a face within the hyperplane with normal `cell_normal`,
+// from the normals of the triangles of its fan summed so that collinear
+// vertices do no harm. Returns false if the face has no area.
+bool face_normal(const Mesh4& mesh, const std::vector<u32>& face, const glm::dvec4& cell_normal, const f64 tolerance,
+                 glm::dvec4& out) {
+    const glm::dvec4& p0 = mesh.vertices[face[0]];
+
+    glm::dvec4 normal(0, 0, 0, 0);
+    for (size_t j = 1; j + 1 < face.size(); j++) {
+        const glm::dvec4 a = mesh.vertices[face[j]] - p0;
+        const glm::dvec4 b = mesh.vertices[face[j + 1]] - p0;
+        if (glm::length(a) > tolerance && glm::length(b) > tolerance) {
+            normal += cross(a, b, cell_normal);
+        }
+    }
+    if (glm::length(normal) <= tolerance * tolerance) {
+        return false;
+    }
+    out = glm::normalize(normal);
+    return true;
+}
+
+// Fan tetrahedra from `apex` over each of `faces` not in a plane through it,
+// splitting each face into a fan of triangles from its first vertex and
+// skipping triangles with no area. The tetrahedra are added to `out_tets` if
+// it is not null. Returns the number of tetrahedra.
+u32 cone_tets(const Mesh4& mesh, const std::vector<std::vector<u32>>& faces,
+              const std::vector<glm::dvec4>& face_normals, const u32 apex, const glm::dvec4& cell_normal,
+              const f64 tolerance, std::vector<u32>* out_tets) {
+    const glm::dvec4& apex_v = mesh.vertices[apex];
+
+    u32 n_tets = 0;
+    for (size_t i = 0; i < faces.size(); i++) {
+        const auto& face = faces[i];
+        const glm::dvec4& p0 = mesh.vertices[face[0]];
+        if (std::abs(glm::dot(face_normals[i], apex_v - p0)) <= tolerance) {
+            continue;
+        }
+
+        for (size_t j = 1; j + 1 < face.size(); j++) {
+            const glm::dvec4 a = mesh.vertices[face[j]] - p0;
+            const glm::dvec4 b = mesh.vertices[face[j + 1]] - p0;
+            if (glm::length(a) <= tolerance || glm::length(b) <= tolerance
+                || glm::length(cross(a, b, cell_normal)) <= tolerance * tolerance) {
+                continue;
+            }
+
+            n_tets++;
+            if (out_tets) {
+                out_tets->push_back(apex);
+                out_tets->push_back(face[0]);
+                out_tets->push_back(face[j]);
+                out_tets->push_back(face[j + 1]);
+            }
+        }
+    }
+    return n_tets;
+}
+
+// The vertex of `vertices` whose cone over `faces` has the fewest tetrahedra,
+// and the number of them. Ties go to the first vertex.
+std::pair<u32, u32> best_cone(const Mesh4& mesh, const std::vector<u32>& vertices,
+                              const std::vector<std::vector<u32>>& faces, const std::vector<glm::dvec4>& face_normals,
+                              const glm::dvec4& cell_normal, const f64 tolerance) {
+    std::pair<u32, u32> best = {vertices[0], (u32)-1};
+    for (u32 v_i : vertices) {
+        const u32 n_tets = cone_tets(mesh, faces, face_normals, v_i, cell_normal, tolerance, NULL);
+        if (n_tets < best.second) {
+            best = {v_i, n_tets};
+        }
+    }
+    return best;
+}
+
+// Split a convex cell into as few tetrahedra as can be found quickly. Every
+// vertex with exactly three neighbours is cut off in turn with a single
+// tetrahedron, leaving the convex hull of the remaining vertices, whose new
+// face is the triangle of the neighbours; what remains is then fanned from
+// its best vertex. This is used if it beats the best fan of the whole cell.
+void tetrahedralize_fewest(const Mesh4& mesh, const CellShape& shape, const std::vector<glm::dvec4>& face_normals,
+                           const glm::dvec4& cell_normal, const f64 tolerance, std::vector<u32>& out_tets) {
+    const auto best = best_cone(mesh, shape.vertices, shape.faces, face_normals, cell_normal, tolerance);
+
+    std::vector<u32> vertices = shape.vertices;
+    std::vector<std::vector<u32>> faces = shape.faces;
+    std::vector<glm::dvec4> normals = face_normals;
+    std::vector<u32> cut_tets;
+    std::vector<u32> neighbours;
+    while (vertices.size() > 4 && cut_tets.size() / 4 < best.second) {
+        bool cut = false;
+        for (size_t v = 0; v < vertices.size() && !cut; v++) {
+            const u32 v_i = vertices[v];
+
+            neighbours.clear();
+            for (const auto& face : faces) {
+                for (size_t j = 0; j < face.size(); j++) {
+                    if (face[j] == v_i) {
+                        neighbours.push_back(face[(j + 1) % face.size()]);
+                        neighbours.push_back(face[(j + face.size() - 1) % face.size()]);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            if (neighbours.size() != 3) {
+                continue;
+            }
+
+            const glm::dvec4& p = mesh.vertices[v_i];
+            const glm::dvec4 a = mesh.vertices[neighbours[0]] - p;
+            const glm::dvec4 b = mesh.vertices[neighbours[1]] - p;
+            const glm::dvec4 c = mesh.vertices[neighbours[2]] - p;
+            if (std::abs(glm::dot(cross(a, b, cell_normal), c)) <= tolerance * sq(shape.size)) {
+                continue;
+            }
+
+            cut_tets.push_back(v_i);
+            cut_tets.insert(cut_tets.end(), neighbours.begin(), neighbours.end());
+
+            for (size_t i = 0; i < faces.size();) {
+                auto& face = faces[i];
+                face.erase(std::remove(face.begin(), face.end(), v_i), face.end());
+                if (face.size() < 3) {
+                    faces.erase(faces.begin() + (std::ptrdiff_t)i);
+                    normals.erase(normals.begin() + (std::ptrdiff_t)i);
+                } else {
+                    i++;
+                }
+            }
+            glm::dvec4 normal;
+            face_normal(mesh, neighbours, cell_normal, tolerance, normal);
+            faces.push_back(neighbours);
+            normals.push_back(normal);
+            vertices.erase(vertices.begin() + (std::ptrdiff_t)v);
+            cut = true;
+        }
+        if (!cut) {
+            break;
+        }
+    }
+
+    const auto rest = best_cone(mesh, vertices, faces, normals, cell_normal, tolerance);
+    if (cut_tets.size() / 4 + rest.second < best.second) {
+        out_tets.insert(out_tets.end(), cut_tets.begin(), cut_tets.end());
+        cone_tets(mesh, faces, normals, rest.first, cell_normal, tolerance, &out_tets);
+    } else {
+        cone_tets(mesh, shape.faces, face_normals, best.first, cell_normal, tolerance, &out_tets);
+    }
+}
+
+// Tetrahedralize a convex cell without TetGen. With `TetMode::fans`, each
+// face that does not contain the cell's first vertex is split into a fan of
+// triangles, and each triangle is joined to that vertex; with
+// `TetMode::fewest`, see `tetrahedralize_fewest`. Convexity is checked in 4D,
+// in the cell's hyperplane: every vertex of the cell must be on the inner
+// side of every face. The tetrahedra index the mesh's own vertices, so none
+// are added. Returns false, without adding anything to the output, if the
+// cell is not convex or not flat, in which case TetGen must be used.
+bool tetrahedralize_convex_cell(const Mesh4& mesh, const CellShape& shape, const TetMode mode,
+                                std::vector<u32>& out_tets) {
+    const auto& vertices = shape.vertices;
+    const auto& faces = shape.faces;
+    const glm::dvec4& centroid = shape.centroid;
+    const f64 tolerance = shape.size * 0.000000001;
+
+    // The normal of the cell's hyperplane, from three directions that span
+    // it, each from the first vertex to the vertex furthest from the span of
+    // those before.
+    const glm::dvec4 origin = mesh.vertices[vertices[0]];
+    glm::dvec4 basis[3];
+    glm::dvec4 directions[3];
+    for (s32 i = 0; i < 3; i++) {
+        f64 best_length = 0.0;
+        for (u32 v_i : vertices) {
+            glm::dvec4 d = mesh.vertices[v_i] - origin;
+            for (s32 j = 0; j < i; j++) {
+                d -= glm::dot(d, basis[j]) * basis[j];
+            }
+            const f64 length = glm::length(d);
+            if (length > best_length) {
+                best_length = length;
+                basis[i] = d / length;
+                directions[i] = mesh.vertices[v_i] - origin;
+            }
+        }
+        if (best_length <= tolerance) {
+            return false;
+        }
+    }
+    const glm::dvec4 cell_normal = glm::normalize(cross(directions[0], directions[1], directions[2]));
+
+    // The outward normal of each face within the hyperplane.
+    std::vector<glm::dvec4> face_normals(faces.size());
+    for (size_t i = 0; i < faces.size(); i++) {
+        const auto& face = faces[i];
+        const glm::dvec4& p0 = mesh.vertices[face[0]];
+
+        glm::dvec4 normal;
+        if (!face_normal(mesh, face, cell_normal, tolerance, normal)) {
+            return false;
+        }
+        if (glm::dot(normal, centroid - p0) > 0.0) {
+            normal = -normal;
+        }
+
+        for (u32 v_i : vertices) {
+            if (glm::dot(normal, mesh.vertices[v_i] - p0) > tolerance) {
+                return false;
+            }
+        }
+        face_normals[i] = normal;
+    }
+
+    // Every vertex must also be in the cell's hyperplane.
+    for (u32 v_i : vertices) {
+        if (std::abs(glm::dot(cell_normal, mesh.vertices[v_i] - origin)) > tolerance) {
+            return false;
+        }
+    }
+
+    if (mode == TetMode::fewest) {
+        tetrahedralize_fewest(mesh, shape, face_normals, cell_normal, tolerance, out_tets);
+    } else {
+        // Faces in a hyperplane through the apex, including those that
+        // contain it, would give flat tetrahedra, and are skipped.
+        cone_tets(mesh, faces, face_normals, vertices[0], cell_normal, tolerance, &out_tets);
+    }
+
+    return true;
+}
+
+// An orthonormal basis of the directions from `corners[0]` to the other
+// corners. Congruent corners give congruent bases.
+void frame_basis(const glm::dvec4 (&corners)[4], glm::dvec4 (&out)[3]) {
+    for (s32 i = 0; i < 3; i++) {
+        glm::dvec4 d = corners[i + 1] - corners[0];
+        for (s32 j = 0; j < i; j++) {
+            d -= glm::dot(d, out[j]) * out[j];
+        }
+        out[i] = glm::normalize(d);
+    }
+}
+
+// Four vertices of a cell that span its hyperplane, used to match the cell
+// with congruent ones. Points of the cell are given coordinates in the basis
+// the corners make.
+struct CellFrame {
+    u32 corners[4];
+
+    // The coordinates of each of the cell's vertices, and the indices of
+    // those coordinates sorted by their first component.
+    std::vector<glm::dvec3> coordinates;
+    std::vector<u32> order;
+};
+
+glm::dvec3 frame_coordinates(const glm::dvec4& origin, const glm::dvec4 (&basis)[3], const glm::dvec4& p) {
+    const glm::dvec4 d = p - origin;
+    return glm::dvec3(glm::dot(basis[0], d), glm::dot(basis[1], d), glm::dot(basis[2], d));
+}
+
+// The corners are the cell's first vertex and, in turn, the vertices furthest
+// from the span of the corners before them. Returns false if the cell is flat.
+bool make_cell_frame(const Mesh4& mesh, const CellShape& shape, CellFrame& out) {
+    const f64 tolerance = shape.size * 0.000001;
+    const glm::dvec4 origin = mesh.vertices[shape.vertices[0]];
+
+    glm::dvec4 corners[4] = {origin};
+    glm::dvec4 basis[3];
+    out.corners[0] = shape.vertices[0];
+    for (s32 i = 0; i < 3; i++) {
+        f64 best_length = 0.0;
+        for (u32 v_i : shape.vertices) {
+            glm::dvec4 d = mesh.vertices[v_i] - origin;
+            for (s32 j = 0; j < i; j++) {
+                d -= glm::dot(d, basis[j]) * basis[j];
+            }
+            const f64 length = glm::length(d);
+            if (length > best_length) {
+                best_length = length;
+                basis[i] = d / length;
+                out.corners[i + 1] = v_i;
+            }
+        }
+        if (best_length <= tolerance) {
+            return false;
+        }
+        corners[i + 1] = mesh.vertices[out.corners[i + 1]];
+    }
+    frame_basis(corners, basis);
+
+    out.coordinates.clear();
+    out.order.clear();
+    for (u32 v_i : shape.vertices) {
+        out.order.push_back((u32)out.coordinates.size());
+        out.coordinates.push_back(frame_coordinates(origin, basis, mesh.vertices[v_i]));
+    }
+    std::sort(out.order.begin(), out.order.end(),
+              [&](u32 a, u32 b) { return out.coordinates[a].x < out.coordinates[b].x; });
+    return true;
+}
+
+// A rigid motion taking a representative cell onto a congruent one.
+struct Congruence {
+
+    // For each of the representative's vertices, in order, the corresponding
+    // vertex of this cell.
+    std::vector<u32> vertices;
+
+    // The images of the representative's frame corners, and their basis.
+    glm::dvec4 corners[4];
+    glm::dvec4 basis[3];
+
+    glm::dvec4 apply(const glm::dvec3& coordinates) const {
+        return corners[0] + coordinates.x * basis[0] + coordinates.y * basis[1] + coordinates.z * basis[2];
+    }
+};
+
+// Find a rigid motion, possibly with a reflection, that takes the vertices and
+// faces of the cell `rep` onto those of the cell `shape`. Each choice of
+// images for the frame corners with the right distances between them fixes a
+// motion, which is accepted if it takes every vertex onto a vertex and every
+// face onto a face.
+bool find_congruence(const Mesh4& mesh, const CellShape& rep, const CellFrame& frame, const CellShape& shape,
+                     Congruence& out) {
+    if (rep.vertices.size() != shape.vertices.size() || rep.faces.size() != shape.faces.size()) {
+        return false;
+    }
+
+    const f64 tolerance = shape.size * 0.000001;
+    for (size_t i = 0; i < rep.radii.size(); i++) {
+        if (std::abs(rep.radii[i] - shape.radii[i]) > tolerance) {
+            return false;
+        }
+    }
+
+    f64 distances[4][4];
+    for (s32 i = 0; i < 4; i++) {
+        for (s32 j = 0; j < i; j++) {
+            distances[i][j] = glm::length(mesh.vertices[frame.corners[i]] - mesh.vertices[frame.corners[j]]);
+        }
+    }
+
+    // The faces of `shape` as sorted sets of vertices, built when first needed.
+    std::vector<std::vector<u32>> shape_faces;
+
+    const auto try_corners = [&]() {
+        frame_basis(out.corners, out.basis);
+
+        // Match each vertex with the representative's vertex whose image is
+        // within the tolerance of it, looking only at those whose first
+        // coordinates are close enough.
+        out.vertices.assign(shape.vertices.size(), (u32)-1);
+        for (u32 v_i : shape.vertices) {
+            const glm::dvec4& v = mesh.vertices[v_i];
+            const f64 x = glm::dot(out.basis[0], v - out.corners[0]);
+            auto it = std::lower_bound(frame.order.begin(), frame.order.end(), x - 2.0 * tolerance,
+                                       [&](u32 i, f64 value) { return frame.coordinates[i].x < value; });
+            for (; it != frame.order.end() && frame.coordinates[*it].x <= x + 2.0 * tolerance; ++it) {
+                if (out.vertices[*it] == (u32)-1 && glm::length(out.apply(frame.coordinates[*it]) - v) <= tolerance) {
+                    break;
+                }
+            }
+            if (it == frame.order.end() || frame.coordinates[*it].x > x + 2.0 * tolerance) {
+                return false;
+            }
+            out.vertices[*it] = v_i;
+        }
+
+        if (shape_faces.empty()) {
+            for (auto face : shape.faces) {
+                std::sort(face.begin(), face.end());
+                shape_faces.push_back(std::move(face));
+            }
+            std::sort(shape_faces.begin(), shape_faces.end());
+        }
+
+        std::vector<u32> face;
+        for (const auto& rep_face : rep.faces) {
+            face.clear();
+            for (u32 v_i : rep_face) {
+                const size_t i = std::lower_bound(rep.vertices.begin(), rep.vertices.end(), v_i) - rep.vertices.begin();
+                face.push_back(out.vertices[i]);
+            }
+            std::sort(face.begin(), face.end());
+            if (!std::binary_search(shape_faces.begin(), shape_faces.end(), face)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Choose images for the corners one at a time, each at the right
+    // distances from those before it.
+    const auto search = [&](const auto& self, s32 corner) -> bool {
+        if (corner == 4) {
+            return try_corners();
+        }
+        for (u32 v_i : shape.vertices) {
+            const glm::dvec4& v = mesh.vertices[v_i];
+            bool fits = true;
+            for (s32 j = 0; j < corner && fits; j++) {
+                fits = std::abs(glm::length(v - out.corners[j]) - distances[corner][j]) <= tolerance;
+            }
+            if (fits) {
+                out.corners[corner] = v;
+                if (self(self, corner + 1)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    return search(search, 0);
+}
+
+// Tetrahedralize a cell with TetGen. Tetrahedron corners that are vertices of
+// the cell are given as indices of the mesh's `vertices`; any Steiner points
+// TetGen adds are appended to `out_steiner_points`, and the corners at them
+// are given as `mesh.vertices.size()` plus their index in that vector.
+void tetrahedralize_cell(const Mesh4& mesh, const u32 cell_i, std::vector<glm::dvec4>& out_steiner_points,
                          std::vector<u32>& out_tets) {
 
     // Calculate normal vector
 
-    const Cell& cell = mesh.cells[(size_t)cell_i];
+    const Cell& cell = mesh.cells[cell_i];
     const Face& face0 = mesh.faces[cell[0]];
     u32 edge0_i = face0[0];
     const Edge& edge0 = mesh.edges[edge0_i];
@@ -144,6 +652,7 @@ void tetrahedralize_cell(const Mesh4& mesh, const s64 cell_i, std::vector<glm::d
 #endif
 
     std::unordered_map<u32, u32> cell3_vertex_i_mapping;
+    std::vector<u32> cell3_mesh_vertices;
     std::vector<glm::dvec3> cell3_vertices;
     std::vector<std::vector<u32>> cell3_faces;
     cell3_faces.reserve(cell.size());
@@ -156,6 +665,7 @@ void tetrahedralize_cell(const Mesh4& mesh, const s64 cell_i, std::vector<glm::d
             for (u32 v_i : e.vertices) {
                 if (!has_key(cell3_vertex_i_mapping, v_i)) {
                     cell3_vertex_i_mapping.emplace(v_i, cell3_vertices.size());
+                    cell3_mesh_vertices.push_back(v_i);
                     glm::dvec4 v = mesh.vertices[v_i];
                     glm::dvec4 v_ = transform(to_3d_trans, v);
                     DCHECK_F(float_eq(v_.w, 0.0));
@@ -164,32 +674,12 @@ void tetrahedralize_cell(const Mesh4& mesh, const s64 cell_i, std::vector<glm::d
             }
         }
 
-        const Edge& e0 = mesh.edges[f[0]];
-        u32 first_vi = e0.v0;
         std::vector<u32> this_mesh_f;
-        this_mesh_f.reserve(f.size());
-        this_mesh_f.push_back(cell3_vertex_i_mapping.at(first_vi));
-
-        u32 prev_edge_i = f[0];
-        u32 next_vi = e0.v1;
-
-        while (next_vi != first_vi) {
-            for (u32 e_i : f) {
-                if (e_i != prev_edge_i) {
-                    const Edge& e = mesh.edges[e_i];
-                    if (e.v0 == next_vi || e.v1 == next_vi) {
-                        this_mesh_f.push_back(cell3_vertex_i_mapping.at(next_vi));
-                        next_vi = e.v0 == next_vi ? e.v1 : e.v0;
-                        prev_edge_i = e_i;
-
-                        goto search_next_vi;
-                    }
-                }
-            }
-            // If the for-loop exits without finding `next_vi`, this is an
-            // invalid face.
+        if (!trace_face(mesh, f, this_mesh_f)) {
             ABORT_F("Invalid face");
-        search_next_vi:;
+        }
+        for (u32& v_i : this_mesh_f) {
+            v_i = cell3_vertex_i_mapping.at(v_i);
         }
 
         DCHECK_EQ_F(f.size(), this_mesh_f.size());
@@ -237,18 +727,59 @@ void tetrahedralize_cell(const Mesh4& mesh, const s64 cell_i, std::vector<glm::d
     out_vertices_3d.reserve(cell3_vertices.size());
     tetrahedralize_polyhedron(cell3_vertices, cell3_faces, out_vertices_3d, out_tets_3d);
 
-    std::unordered_map<u32, u32> tet_out_vertex_i_mapping;
-    for (size_t i = 0; i < out_vertices_3d.size(); i++) {
-        tet_out_vertex_i_mapping.emplace(i, out_vertices.size());
+    // TetGen's output starts with the input points, in order, followed by
+    // any Steiner points.
+    CHECK_GE_F(out_vertices_3d.size(), cell3_vertices.size());
+    std::vector<u32> tet_out_vertex_i_mapping = std::move(cell3_mesh_vertices);
+    for (size_t i = cell3_vertices.size(); i < out_vertices_3d.size(); i++) {
+        tet_out_vertex_i_mapping.push_back((u32)(mesh.vertices.size() + out_steiner_points.size()));
         const auto& v = out_vertices_3d[i];
         auto v_ = transform(temp_transform_inverse, v);
-        out_vertices.push_back(transform(to_3d_trans_inverse, glm::dvec4(v_, 0.0)));
+        out_steiner_points.push_back(transform(to_3d_trans_inverse, glm::dvec4(v_, 0.0)));
     }
 
     for (u32 i : out_tets_3d) {
         out_tets.push_back(tet_out_vertex_i_mapping.at(i));
     }
 }
+
+// Files written before tetrahedra shared the mesh's vertices hold a copy of
+// each vertex for every cell it is in, off by rounding error from the vertex
+// itself. Point the tetrahedra at the mesh's own vertices instead, and merge
+// the remaining tet vertices that are copies of each other. Points are matched
+// relative to the size of the mesh, so the tolerance does not depend on its
+// scale.
+void share_tet_vertices(Mesh4& mesh) {
+    f64 extent = 0.0;
+    for (const glm::dvec4& v : mesh.vertices) {
+        for (s32 i = 0; i < 4; i++) {
+            extent = std::max(extent, std::abs(v[i]));
+        }
+    }
+    const f64 inv_extent = extent > 0.0 ? 1.0 / extent : 1.0;
+
+    PointIndex4 point_index;
+    for (u32 i = 0; i < (u32)mesh.vertices.size(); i++) {
+        point_index.insert(mesh.vertices[i] * inv_extent, i);
+    }
+
+    std::vector<u32> mapping(mesh.tet_vertices.size());
+    std::vector<glm::dvec4> tet_vertices = mesh.vertices;
+    for (size_t i = 0; i < mesh.tet_vertices.size(); i++) {
+        const glm::dvec4& v = mesh.tet_vertices[i];
+        if (!point_index.find(v * inv_extent, mapping[i])) {
+            mapping[i] = (u32)insert_back(tet_vertices, v);
+            point_index.insert(v * inv_extent, mapping[i]);
+        }
+    }
+
+    for (auto& tet : mesh.tets) {
+        for (u32& v_i : tet.vertices) {
+            v_i = mapping[v_i];
+        }
+    }
+    mesh.tet_vertices = std::move(tet_vertices);
+}
 } // namespace
 
 size_t FaceHash::operator()(const std::vector<u32>& x) const {
@@ -280,15 +811,108 @@ bool operator==(const Edge& lhs, const Edge& rhs) {
     return (lhs.v0 == rhs.v0 && lhs.v1 == rhs.v1) || (lhs.v0 == rhs.v1 && lhs.v1 == rhs.v0);
 }
 
-void tetrahedralize(Mesh4& mesh) {
-    mesh.tet_vertices.clear();
+void tetrahedralize(Mesh4& mesh, GenerateProgress* progress, const TetMode mode) {
+    mesh.tet_vertices = mesh.vertices;
     mesh.tets.clear();
 
-    std::vector<u32> out_tets;
+    if (progress) {
+        progress->stage = GenerateProgress::Stage::tetrahedralize;
+        progress->n_tetrahedralized_cells = 0;
+    }
 
-    for (s64 cell_i = 0; cell_i < (s64)mesh.cells.size(); cell_i++) {
-        const Cell& cell = mesh.cells[(size_t)cell_i];
-        out_tets.clear();
+    const u32 n_cells = (u32)mesh.cells.size();
+    const u32 n_workers = hardware_threads();
+
+    // Sort the cells into classes of congruent cells. Only the first cell of
+    // each class, its representative, is tetrahedralized; the tetrahedra are
+    // then carried onto the others. Cells that are already tetrahedra, and
+    // cells that cannot be traced or are flat, are left in classes of their
+    // own.
+    std::vector<CellShape> shapes(n_cells);
+    // Not `std::vector<bool>`, whose elements cannot be written from different
+    // threads at once.
+    std::vector<u8> traced(n_cells);
+    parallel_for("trace cells", n_cells, n_workers, [&](u32 cell_i, u32) {
+        if (mesh.cells[cell_i].size() > 4) {
+            traced[cell_i] = trace_cell(mesh, cell_i, shapes[cell_i]);
+        }
+    });
+
+    std::vector<u32> cell_reps(n_cells);
+    std::vector<Congruence> congruences(n_cells);
+    std::vector<CellFrame> frames(n_cells);
+    std::vector<u32> rep_cells;
+    std::vector<u32> mapped_cells;
+    {
+        // Candidate representatives by numbers of vertices and faces.
+        std::map<std::pair<size_t, size_t>, std::vector<u32>> reps_by_size;
+
+        for (u32 cell_i = 0; cell_i < n_cells; cell_i++) {
+            if (progress && progress->cancelled()) {
+                return;
+            }
+
+            cell_reps[cell_i] = cell_i;
+            if (traced[cell_i]) {
+                const CellShape& shape = shapes[cell_i];
+                auto& reps = reps_by_size[{shape.vertices.size(), shape.faces.size()}];
+                for (u32 rep_i : reps) {
+                    if (find_congruence(mesh, shapes[rep_i], frames[rep_i], shape, congruences[cell_i])) {
+                        cell_reps[cell_i] = rep_i;
+                        break;
+                    }
+                }
+                if (cell_reps[cell_i] == cell_i && make_cell_frame(mesh, shape, frames[cell_i])) {
+                    reps.push_back(cell_i);
+                }
+            }
+
+            if (cell_reps[cell_i] == cell_i) {
+                rep_cells.push_back(cell_i);
+            } else {
+                mapped_cells.push_back(cell_i);
+            }
+        }
+    }
+    LOG_F(1, "%lu of %u cells are congruent to earlier cells", mapped_cells.size(), n_cells);
+
+    // The tetrahedra share the mesh's vertices, followed by any Steiner points
+    // TetGen adds. Each worker appends the tetrahedra and Steiner points of its
+    // cells to its own buffers, and records where each cell's output went. The
+    // buffers are then merged in cell order, so the result does not depend on
+    // which worker did which cell. Representatives and the cells mapped from
+    // them are done in separate passes with separate buffers, so that the
+    // buffers read from in the second pass are not being written to.
+    struct WorkerOutput {
+        std::vector<glm::dvec4> steiner_points;
+        std::vector<u32> tets;
+    };
+
+    struct CellOutput {
+        const WorkerOutput* output;
+        u32 steiner_points_begin;
+        u32 steiner_points_end;
+        u32 tets_begin;
+        u32 tets_end;
+    };
+
+    const u32 n_vertices = (u32)mesh.vertices.size();
+    std::vector<WorkerOutput> rep_outputs(n_workers);
+    std::vector<WorkerOutput> mapped_outputs(n_workers);
+    std::vector<CellOutput> cell_outputs(n_cells);
+
+    parallel_for("tetrahedralize", (u32)rep_cells.size(), n_workers, [&](u32 i, u32 worker) {
+        if (progress && progress->cancelled()) {
+            return;
+        }
+
+        const u32 cell_i = rep_cells[i];
+        const Cell& cell = mesh.cells[cell_i];
+        WorkerOutput& output = rep_outputs[worker];
+        CellOutput& cell_output = cell_outputs[cell_i];
+        cell_output.output = &output;
+        cell_output.steiner_points_begin = (u32)output.steiner_points.size();
+        cell_output.tets_begin = (u32)output.tets.size();
 
         DCHECK_GE_F(cell.size(), 4u);
         if (cell.size() == 4) {
@@ -302,248 +926,177 @@ void tetrahedralize(Mesh4& mesh) {
                     for (u32 v_i : e.vertices) {
                         if (!contains(vertex_indices, v_i)) {
                             vertex_indices.push_back(v_i);
-                            out_tets.push_back((u32)mesh.tet_vertices.size());
-                            mesh.tet_vertices.push_back(mesh.vertices[v_i]);
+                            output.tets.push_back(v_i);
                         }
                     }
                 }
             }
 
-        } else {
-            LOG_F(1, "Tetrahedralizing cell %li with %lu faces", cell_i, cell.size());
-            tetrahedralize_cell(mesh, cell_i, mesh.tet_vertices, out_tets);
-        }
-
-        DCHECK_EQ_F((s64)out_tets.size() % 4, 0);
-        for (size_t tet_i = 0; tet_i < out_tets.size() / 4; tet_i++) {
-            Mesh4::Tet tet;
-            tet.cell = (u32)cell_i;
-            for (size_t j = 0; j < 4; j++) {
-                tet.vertices[j] = out_tets[tet_i * 4 + j];
-            }
-            mesh.tets.push_back(tet);
+        } else if (!traced[cell_i] || !tetrahedralize_convex_cell(mesh, shapes[cell_i], mode, output.tets)) {
+            LOG_F(1, "Tetrahedralizing non-convex cell %u with %lu faces", cell_i, cell.size());
+            tetrahedralize_cell(mesh, cell_i, output.steiner_points, output.tets);
         }
-    }
-}
 
-bool save_mesh_to_file(const Mesh4& mesh, const char* path) {
-    txml::XMLDocument doc;
-    doc.InsertFirstChild(doc.NewDeclaration());
+        cell_output.steiner_points_end = (u32)output.steiner_points.size();
+        cell_output.tets_end = (u32)output.tets.size();
+        DCHECK_EQ_F((cell_output.tets_end - cell_output.tets_begin) % 4, 0u);
 
-    txml::XMLElement* root = doc.NewElement("mesh4");
-    root->SetAttribute("name", mesh.name.c_str());
-    doc.InsertEndChild(root);
+        if (progress) {
+            progress->n_tetrahedralized_cells++;
+        }
+    });
 
-    txml::XMLElement* vertices_xmle = doc.NewElement("vertices");
-    root->InsertFirstChild(vertices_xmle);
+    parallel_for("map tetrahedra", (u32)mapped_cells.size(), n_workers, [&](u32 i, u32 worker) {
+        if (progress && progress->cancelled()) {
+            return;
+        }
 
-    for (const auto& v : mesh.vertices) {
-        txml::XMLElement* v_xmle = doc.NewElement("vec4");
-        v_xmle->SetAttribute("x", v.x);
-        v_xmle->SetAttribute("y", v.y);
-        v_xmle->SetAttribute("z", v.z);
-        v_xmle->SetAttribute("w", v.w);
-        vertices_xmle->InsertEndChild(v_xmle);
-    }
+        const u32 cell_i = mapped_cells[i];
+        const u32 rep_i = cell_reps[cell_i];
+        const CellShape& rep = shapes[rep_i];
+        const CellFrame& frame = frames[rep_i];
+        const CellOutput& rep_output = cell_outputs[rep_i];
+        const Congruence& congruence = congruences[cell_i];
+
+        WorkerOutput& output = mapped_outputs[worker];
+        CellOutput& cell_output = cell_outputs[cell_i];
+        cell_output.output = &output;
+        cell_output.steiner_points_begin = (u32)output.steiner_points.size();
+        cell_output.tets_begin = (u32)output.tets.size();
+
+        if (rep_output.steiner_points_begin != rep_output.steiner_points_end) {
+            glm::dvec4 corners[4];
+            glm::dvec4 basis[3];
+            for (s32 j = 0; j < 4; j++) {
+                corners[j] = mesh.vertices[frame.corners[j]];
+            }
+            frame_basis(corners, basis);
 
-    txml::XMLElement* edges_xmle = doc.NewElement("edges");
-    root->InsertEndChild(edges_xmle);
+            for (u32 j = rep_output.steiner_points_begin; j < rep_output.steiner_points_end; j++) {
+                const glm::dvec4& p = rep_output.output->steiner_points[j];
+                output.steiner_points.push_back(congruence.apply(frame_coordinates(corners[0], basis, p)));
+            }
+        }
 
-    for (const auto& e : mesh.edges) {
-        txml::XMLElement* e_xmle = doc.NewElement("edge");
-        e_xmle->SetAttribute("v0", e.v0);
-        e_xmle->SetAttribute("v1", e.v1);
-        edges_xmle->InsertEndChild(e_xmle);
-    }
+        for (u32 j = rep_output.tets_begin; j < rep_output.tets_end; j++) {
+            const u32 v_i = rep_output.output->tets[j];
+            if (v_i < n_vertices) {
+                const size_t k = std::lower_bound(rep.vertices.begin(), rep.vertices.end(), v_i) - rep.vertices.begin();
+                DCHECK_LT_F(k, rep.vertices.size());
+                output.tets.push_back(congruence.vertices[k]);
+            } else {
+                output.tets.push_back(v_i - rep_output.steiner_points_begin + cell_output.steiner_points_begin);
+            }
+        }
 
-    txml::XMLElement* faces_xmle = doc.NewElement("faces");
-    root->InsertEndChild(faces_xmle);
+        cell_output.steiner_points_end = (u32)output.steiner_points.size();
+        cell_output.tets_end = (u32)output.tets.size();
 
-    for (const auto& f : mesh.faces) {
-        txml::XMLElement* indices_xmle = doc.NewElement("indices");
-        for (u32 index : f) {
-            txml::XMLElement* index_xmle = doc.NewElement("index");
-            index_xmle->SetText(index);
-            indices_xmle->InsertEndChild(index_xmle);
+        if (progress) {
+            progress->n_tetrahedralized_cells++;
         }
-        faces_xmle->InsertEndChild(indices_xmle);
-    }
+    });
 
-    txml::XMLElement* cells_xmle = doc.NewElement("cells");
-    root->InsertEndChild(cells_xmle);
+    if (progress && progress->cancelled()) {
+        return;
+    }
 
-    for (const auto& c : mesh.cells) {
-        txml::XMLElement* indices_xmle = doc.NewElement("indices");
-        for (u32 index : c) {
-            txml::XMLElement* index_xmle = doc.NewElement("index");
-            index_xmle->SetText(index);
-            indices_xmle->InsertEndChild(index_xmle);
+    size_t n_tet_vertices = mesh.vertices.size();
+    size_t n_tets = 0;
+    for (const auto* outputs : {&rep_outputs, &mapped_outputs}) {
+        for (const auto& output : *outputs) {
+            n_tet_vertices += output.steiner_points.size();
+            n_tets += output.tets.size() / 4;
         }
-        cells_xmle->InsertEndChild(indices_xmle);
     }
+    mesh.tet_vertices.reserve(n_tet_vertices);
+    mesh.tets.reserve(n_tets);
 
-    txml::XMLElement* tet_vertices_xmle = doc.NewElement("tet_vertices");
-    root->InsertEndChild(tet_vertices_xmle);
+    for (u32 cell_i = 0; cell_i < n_cells; cell_i++) {
+        const CellOutput& cell_output = cell_outputs[cell_i];
+        const WorkerOutput& output = *cell_output.output;
 
-    for (const auto& v : mesh.tet_vertices) {
-        txml::XMLElement* v_xmle = doc.NewElement("vec4");
-        v_xmle->SetAttribute("x", v.x);
-        v_xmle->SetAttribute("y", v.y);
-        v_xmle->SetAttribute("z", v.z);
-        v_xmle->SetAttribute("w", v.w);
-        tet_vertices_xmle->InsertEndChild(v_xmle);
-    }
-
-    txml::XMLElement* tets_xmle = doc.NewElement("tets");
-    root->InsertEndChild(tets_xmle);
+        // Indices of Steiner points are relative to the worker's buffer.
+        const u32 offset = (u32)mesh.tet_vertices.size() - cell_output.steiner_points_begin;
+        mesh.tet_vertices.insert(mesh.tet_vertices.end(),
+                                 output.steiner_points.begin() + cell_output.steiner_points_begin,
+                                 output.steiner_points.begin() + cell_output.steiner_points_end);
 
-    for (const Mesh4::Tet& tet : mesh.tets) {
-        txml::XMLElement* tet_xmle = doc.NewElement("tet");
-        tet_xmle->SetAttribute("cell", tet.cell);
-        tet_xmle->SetAttribute("v0", tet.vertices[0]);
-        tet_xmle->SetAttribute("v1", tet.vertices[1]);
-        tet_xmle->SetAttribute("v2", tet.vertices[2]);
-        tet_xmle->SetAttribute("v3", tet.vertices[3]);
-        tets_xmle->InsertEndChild(tet_xmle);
-    }
-
-    txml::XMLError error = doc.SaveFile(path);
-    if (error) {
-        LOG_F(ERROR, "%s", txml::XMLDocument::ErrorIDToName(error));
-        return false;
+        for (u32 i = cell_output.tets_begin; i < cell_output.tets_end; i += 4) {
+            Mesh4::Tet tet;
+            tet.cell = cell_i;
+            for (u32 j = 0; j < 4; j++) {
+                const u32 v_i = output.tets[i + j];
+                tet.vertices[j] = v_i < n_vertices ? v_i : v_i - n_vertices + offset;
+            }
+            mesh.tets.push_back(tet);
+        }
     }
 
-    return true;
+    LOG_F(INFO, "Split %u cells into %lu tetrahedra, %.2f per cell", n_cells, mesh.tets.size(),
+          n_cells > 0 ? (f64)mesh.tets.size() / (f64)n_cells : 0.0);
 }
 
-// FIXME: Don't crash if the file is not valid.
-Mesh4 load_mesh_from_file(const char* path) {
-    txml::XMLDocument doc;
-    txml::XMLError error = doc.LoadFile(path);
-    if (error) {
-        ABORT_F("%s", txml::XMLDocument::ErrorIDToName(error));
-    }
-
-    Mesh4 result;
-
-    txml::XMLElement* root = doc.RootElement();
-    CHECK_F(c_str_eq(root->Name(), "mesh4"));
-
-    const char* name_str = "";
-    root->QueryStringAttribute("name", &name_str);
-    result.name = std::string(name_str);
-
-    txml::XMLElement* vertices_xmle = root->FirstChildElement();
-    CHECK_F(c_str_eq(vertices_xmle->Name(), "vertices"));
-
-    for (txml::XMLElement* v_xmle = vertices_xmle->FirstChildElement(); v_xmle != NULL;
-         v_xmle = v_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(v_xmle->Name(), "vec4"));
+bool valid_indices(const Mesh4& mesh) {
+    const auto valid_lists = [](const std::vector<std::vector<u32>>& lists, const size_t index_end) {
+        for (const auto& list : lists) {
+            for (u32 index : list) {
+                if (index >= index_end) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
 
-        glm::dvec4 v = {};
-        v_xmle->QueryDoubleAttribute("x", &v.x);
-        v_xmle->QueryDoubleAttribute("y", &v.y);
-        v_xmle->QueryDoubleAttribute("z", &v.z);
-        v_xmle->QueryDoubleAttribute("w", &v.w);
-        result.vertices.push_back(v);
+    for (const Edge& e : mesh.edges) {
+        if (e.v0 >= mesh.vertices.size() || e.v1 >= mesh.vertices.size()) {
+            return false;
+        }
     }
-
-    txml::XMLElement* edges_xmle = vertices_xmle->NextSiblingElement();
-    CHECK_F(c_str_eq(edges_xmle->Name(), "edges"));
-
-    for (txml::XMLElement* e_xmle = edges_xmle->FirstChildElement(); e_xmle != NULL;
-         e_xmle = e_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(e_xmle->Name(), "edge"));
-
-        Edge e = {};
-        e_xmle->QueryUnsignedAttribute("v0", &e.v0);
-        e_xmle->QueryUnsignedAttribute("v1", &e.v1);
-        result.edges.push_back(e);
+    if (!valid_lists(mesh.faces, mesh.edges.size()) || !valid_lists(mesh.cells, mesh.faces.size())) {
+        return false;
     }
-
-    txml::XMLElement* faces_xmle = edges_xmle->NextSiblingElement();
-    CHECK_F(c_str_eq(faces_xmle->Name(), "faces"));
-
-    for (txml::XMLElement* f_xmle = faces_xmle->FirstChildElement(); f_xmle != NULL;
-         f_xmle = f_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(f_xmle->Name(), "indices"));
-
-        std::vector<u32> face;
-
-        for (txml::XMLElement* index_xmle = f_xmle->FirstChildElement(); index_xmle != NULL;
-             index_xmle = index_xmle->NextSiblingElement()) {
-
-            CHECK_F(c_str_eq(index_xmle->Name(), "index"));
-
-            u32 value = 0;
-            index_xmle->QueryUnsignedText(&value);
-            face.push_back(value);
+    for (const Mesh4::Tet& tet : mesh.tets) {
+        if (tet.cell >= mesh.cells.size()) {
+            return false;
         }
-
-        result.faces.push_back(std::move(face));
-    }
-
-    txml::XMLElement* cells_xmle = faces_xmle->NextSiblingElement();
-    CHECK_F(c_str_eq(cells_xmle->Name(), "cells"));
-
-    for (txml::XMLElement* c_xmle = cells_xmle->FirstChildElement(); c_xmle != NULL;
-         c_xmle = c_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(c_xmle->Name(), "indices"));
-
-        std::vector<u32> cell;
-
-        for (txml::XMLElement* index_xmle = c_xmle->FirstChildElement(); index_xmle != NULL;
-             index_xmle = index_xmle->NextSiblingElement()) {
-
-            CHECK_F(c_str_eq(index_xmle->Name(), "index"));
-
-            u32 value = 0;
-            index_xmle->QueryUnsignedText(&value);
-            cell.push_back(value);
+        for (u32 v : tet.vertices) {
+            if (v >= mesh.tet_vertices.size()) {
+                return false;
+            }
         }
-
-        result.cells.push_back(std::move(cell));
     }
+    return true;
+}
 
-    txml::XMLElement* tet_vertices_xmle = cells_xmle->NextSiblingElement();
-    CHECK_F(c_str_eq(tet_vertices_xmle->Name(), "tet_vertices"));
-
-    for (txml::XMLElement* v_xmle = tet_vertices_xmle->FirstChildElement(); v_xmle != NULL;
-         v_xmle = v_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(v_xmle->Name(), "vec4"));
+bool save_mesh_to_file(const Mesh4& mesh, const char* path) {
+    return write_mesh_xml(mesh, path);
+}
 
-        glm::dvec4 v = {};
-        v_xmle->QueryDoubleAttribute("x", &v.x);
-        v_xmle->QueryDoubleAttribute("y", &v.y);
-        v_xmle->QueryDoubleAttribute("z", &v.z);
-        v_xmle->QueryDoubleAttribute("w", &v.w);
-        result.tet_vertices.push_back(v);
+bool load_mesh_from_file(const char* path, Mesh4& out) {
+    if (is_binary_mesh_file(path)) {
+        return load_mesh_binary(path, out);
     }
 
-    txml::XMLElement* tets_xmle = tet_vertices_xmle->NextSiblingElement();
-    CHECK_F(c_str_eq(tets_xmle->Name(), "tets"));
+    const auto start = std::chrono::steady_clock::now();
 
-    for (txml::XMLElement* tet_xmle = tets_xmle->FirstChildElement(); tet_xmle != NULL;
-         tet_xmle = tet_xmle->NextSiblingElement()) {
-
-        CHECK_F(c_str_eq(tet_xmle->Name(), "tet"));
+    std::vector<char> contents;
+    if (!read_file(path, contents)) {
+        LOG_F(ERROR, "Could not read %s", path);
+        return false;
+    }
 
-        Mesh4::Tet tet;
-        tet_xmle->QueryUnsignedAttribute("cell", &tet.cell);
-        tet_xmle->QueryUnsignedAttribute("v0", &tet.vertices[0]);
-        tet_xmle->QueryUnsignedAttribute("v1", &tet.vertices[1]);
-        tet_xmle->QueryUnsignedAttribute("v2", &tet.vertices[2]);
-        tet_xmle->QueryUnsignedAttribute("v3", &tet.vertices[3]);
-        result.tets.push_back(tet);
+    Mesh4 result;
+    if (!parse_mesh_xml(path, contents.data(), contents.size(), result)) {
+        return false;
     }
+    share_tet_vertices(result);
 
-    LOG_F(INFO, "Loaded Mesh4 from \"%s\" with %lu vertices, %lu edges, %lu faces, %lu cells.", path,
-          result.vertices.size(), result.edges.size(), result.faces.size(), result.cells.size());
-    return result;
+    const f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_F(INFO, "Loaded Mesh4 from \"%s\" with %lu vertices, %lu edges, %lu faces, %lu cells in %.1f ms.", path,
+          result.vertices.size(), result.edges.size(), result.faces.size(), result.cells.size(), ms);
+    out = std::move(result);
+    return true;
 }
 } // namespace four
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <four/math.hpp>
+#include <four/progress.hpp>
 #include <four/utility.hpp>
 
 #include <stdint.h>
@@ -53,7 +54,9 @@ struct Mesh4 {
     std::vector<Cell> cells;
 
     // Vector of four-dimensional points that represent the vertices of the
-    // tetrahedralization of the mesh.
+    // tetrahedralization of the mesh: a copy of `vertices`, followed by any
+    // points added inside cells. Each point is shared by all the tetrahedra
+    // that meet at it.
     std::vector<glm::dvec4> tet_vertices;
 
     std::vector<Tet> tets;
@@ -74,14 +77,57 @@ struct FaceEquals {
 using CellHash = FaceHash;
 using CellEquals = FaceEquals;
 
+// Hash for a face or cell whose indices are already sorted. Unlike `FaceHash`
+// it keeps no scratch state, so it can be shared between threads.
+struct SortedIndicesHash {
+    size_t operator()(const std::vector<u32>& x) const {
+        size_t hash = 0;
+        for (u32 value : x) {
+            hash_combine(hash, value);
+        }
+        return hash;
+    }
+};
+
 bool operator==(const Edge& lhs, const Edge& rhs);
 
+// The switches `tetrahedralize` passes to TetGen.
+inline constexpr char tetgen_switches[] = "pYzFQ";
+
+// How `tetrahedralize` splits convex cells.
+enum class TetMode {
+
+    // Fan each cell from its first vertex.
+    fans,
+
+    // Search for a split with fewer tetrahedra, which makes each cross section
+    // cheaper to calculate. Takes longer than `fans`.
+    fewest,
+};
+
 // Calculate the tetrahedralization of `mesh`, filling in the `tet_vertices` and
-// `tets` fields.
-void tetrahedralize(Mesh4& mesh);
+// `tets` fields. Cells are sorted into classes of congruent cells, and only one
+// cell of each class is tetrahedralized; its tetrahedra are carried onto the
+// others, so congruent cells are split alike. Convex cells are split directly
+// into fans of tetrahedra; only non-convex cells are passed to TetGen. Cells
+// are tetrahedralized in parallel, and the result is the same as if they were
+// done one at a time in order. The tetrahedra share the mesh's vertices, so
+// `tet_vertices` starts with a copy of `vertices`. If `progress` is given, the
+// number of cells done is reported to it, and the tetrahedralization stops
+// early if it is cancelled.
+void tetrahedralize(Mesh4& mesh, GenerateProgress* progress = NULL, TetMode mode = TetMode::fans);
+
+// Whether every index in `mesh` is in range: the vertices of its edges, the
+// edges of its faces, the faces of its cells and the cells and vertices of its
+// tetrahedra.
+bool valid_indices(const Mesh4& mesh);
 
 bool save_mesh_to_file(const Mesh4& mesh, const char* path);
-Mesh4 load_mesh_from_file(const char* path);
+
+// Load a mesh from either an XML `.mesh4` file or a binary mesh file (see
+// mesh_binary.hpp), whichever `path` holds. Returns false and logs an error if
+// the file cannot be read or is malformed.
+bool load_mesh_from_file(const char* path, Mesh4& out);
 
 } // namespace four
 
@@ -0,0 +1,880 @@
+#include <four/mesh_binary.hpp>
+
+#include <four/file_writer.hpp>
+#include <four/parallel.hpp>
+
+#include <loguru.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+#ifndef __WIN32__
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace four {
+
+namespace {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Binary mesh files are little-endian");
+static_assert(sizeof(glm::dvec4) == 32 && std::is_trivially_copyable_v<glm::dvec4>);
+static_assert(sizeof(Edge) == 8 && std::is_trivially_copyable_v<Edge>);
+static_assert(sizeof(Mesh4::Tet) == 20 && std::is_trivially_copyable_v<Mesh4::Tet>);
+
+// Bump when the layout changes. Files of other versions are rejected.
+constexpr u32 format_version = 2;
+
+constexpr char file_magic[8] = {'f', 'o', 'u', 'r', '-', 'm', '4', 'b'};
+
+// Every section starts at a multiple of this, which is at least the alignment
+// of any element type, so that a mapping can be used in place.
+constexpr u64 section_alignment = 64;
+
+enum Section : u32 {
+    name_section,
+    vertices_section,
+    edges_section,
+    face_offsets_section,
+    face_indices_section,
+    cell_offsets_section,
+    cell_indices_section,
+    tet_vertices_section,
+    tets_section,
+    n_sections,
+};
+
+enum Encoding : u32 {
+
+    // The elements as they are laid out in memory.
+    raw_encoding,
+
+    // Faces or cells in blocks of varints (see `write_blocks`). Each face or
+    // cell is its number of indices, followed by the difference between each
+    // index and the one before it. All of it is stored in the offsets
+    // section, and the indices section is empty.
+    lists_encoding,
+
+    // Tets in blocks of varints: the difference between the cell and the
+    // previous tet's cell, then between each vertex and the one before it.
+    tets_encoding,
+
+    // `tet_vertices` as a u64 count of leading points that are copies of
+    // `vertices`, followed by the rest. If the section's parameter is 0, they
+    // are stored as f64s. Otherwise it is 16 or 32, and they are stored as the
+    // minimum and step of each coordinate, as f64s, followed by each point's
+    // coordinates as u16s or u32s.
+    points_encoding,
+};
+
+// The size of an element of each uncompressed section.
+constexpr u64 element_sizes[n_sections] = {1, 32, 8, 4, 4, 4, 4, 32, 20};
+
+struct FileSection {
+    u64 offset;
+    u64 size;
+    u64 count;
+    u32 encoding;
+    u32 parameter;
+};
+
+struct FileHeader {
+    char magic[8];
+    u32 version;
+    u32 header_size;
+    u64 file_size;
+    FileSection sections[n_sections];
+};
+
+// The number of faces, cells or tets in each block of a compressed section.
+constexpr u64 block_length = 4096;
+
+u64 align_up(const u64 x) {
+    return (x + section_alignment - 1) / section_alignment * section_alignment;
+}
+
+u64 n_blocks(const u64 n) {
+    return (n + block_length - 1) / block_length;
+}
+
+// The number of indices in a vector of faces or cells.
+u64 total_size(const std::vector<std::vector<u32>>& lists) {
+    u64 result = 0;
+    for (const auto& list : lists) {
+        result += list.size();
+    }
+    return result;
+}
+
+// Check that CSR `offsets` run from 0 to the end of `indices` without going
+// back, and that every index is below `index_end`.
+bool valid_index_lists(const MappedArray<u32>& offsets, const MappedArray<u32>& indices, const size_t index_end) {
+    if (offsets.size == 0 || offsets[0] != 0 || offsets[offsets.size - 1] != indices.size) {
+        return false;
+    }
+    for (size_t i = 1; i < offsets.size; i++) {
+        if (offsets[i] < offsets[i - 1]) {
+            return false;
+        }
+    }
+    for (u32 index : indices) {
+        if (index >= index_end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Map signed differences to unsigned values, small magnitudes to small
+// values, so that they make short varints.
+u64 zigzag(const s64 x) {
+    return ((u64)x << 1) ^ (u64)(x >> 63);
+}
+
+s64 unzigzag(const u64 x) {
+    return (s64)(x >> 1) ^ -(s64)(x & 1);
+}
+
+// Counts the bytes that an encoder writes, so that sections can be sized
+// before they are written.
+struct ByteCounter {
+    u64 size = 0;
+
+    void put(char) {
+        size++;
+    }
+};
+
+// Write `value` 7 bits at a time, low bits first, with the high bit of each
+// byte set if more follow.
+template <class Sink>
+void put_varint(Sink& sink, u64 value) {
+    while (value >= 0x80) {
+        sink.put((char)(value | 0x80));
+        value >>= 7;
+    }
+    sink.put((char)value);
+}
+
+template <class Sink>
+void put_delta(Sink& sink, const u32 value, u32& previous) {
+    put_varint(sink, zigzag((s64)value - (s64)previous));
+    previous = value;
+}
+
+// Reads values written by `put_varint`. Every read checks that the data is
+// long enough and that the value is in range.
+struct VarintReader {
+    const u8* pos;
+    const u8* end;
+
+    bool get(u64& out) {
+        out = 0;
+        for (u32 shift = 0; shift < 64; shift += 7) {
+            if (pos == end) {
+                return false;
+            }
+            const u8 byte = *pos++;
+            out |= (u64)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Read a difference written by `put_delta` and apply it to `previous`.
+    bool get_delta(u32& previous) {
+        u64 x;
+        if (!get(x) || x > (u64)UINT32_MAX * 2 + 1) {
+            return false;
+        }
+        const s64 value = (s64)previous + unzigzag(x);
+        if (value < 0 || value > (s64)UINT32_MAX) {
+            return false;
+        }
+        previous = (u32)value;
+        return true;
+    }
+};
+
+template <class Sink>
+void encode_lists(Sink& sink, const std::vector<std::vector<u32>>& lists, const size_t begin, const size_t end) {
+    u32 previous = 0;
+    for (size_t i = begin; i < end; i++) {
+        put_varint(sink, lists[i].size());
+        for (u32 index : lists[i]) {
+            put_delta(sink, index, previous);
+        }
+    }
+}
+
+bool decode_lists(VarintReader& reader, std::vector<std::vector<u32>>& lists, const size_t begin,
+                  const size_t end) {
+    u32 previous = 0;
+    for (size_t i = begin; i < end; i++) {
+        u64 size;
+        if (!reader.get(size) || size > (u64)(reader.end - reader.pos)) {
+            return false;
+        }
+        lists[i].resize(size);
+        for (u32& index : lists[i]) {
+            if (!reader.get_delta(previous)) {
+                return false;
+            }
+            index = previous;
+        }
+    }
+    return true;
+}
+
+template <class Sink>
+void encode_tets(Sink& sink, const std::vector<Mesh4::Tet>& tets, const size_t begin, const size_t end) {
+    u32 previous_cell = 0;
+    u32 previous_vertex = 0;
+    for (size_t i = begin; i < end; i++) {
+        put_delta(sink, tets[i].cell, previous_cell);
+        for (u32 v : tets[i].vertices) {
+            put_delta(sink, v, previous_vertex);
+        }
+    }
+}
+
+bool decode_tets(VarintReader& reader, std::vector<Mesh4::Tet>& tets, const size_t begin, const size_t end) {
+    u32 previous_cell = 0;
+    u32 previous_vertex = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (!reader.get_delta(previous_cell)) {
+            return false;
+        }
+        tets[i].cell = previous_cell;
+        for (u32& v : tets[i].vertices) {
+            if (!reader.get_delta(previous_vertex)) {
+                return false;
+            }
+            v = previous_vertex;
+        }
+    }
+    return true;
+}
+
+// The sizes of a section of blocks, measured in parallel: the end of each
+// block, relative to the end of the block table. `encode(sink, begin, end)`
+// encodes elements [begin, end).
+template <class Encode>
+std::vector<u64> block_ends(const u64 n, Encode&& encode) {
+    std::vector<u64> ends(n_blocks(n));
+    parallel_for("measure blocks", (u32)ends.size(), hardware_threads(), [&](u32 block, u32) {
+        ByteCounter counter;
+        encode(counter, block * block_length, std::min((block + 1) * block_length, n));
+        ends[block] = counter.size;
+    });
+    for (size_t i = 1; i < ends.size(); i++) {
+        ends[i] += ends[i - 1];
+    }
+    return ends;
+}
+
+u64 blocks_size(const std::vector<u64>& ends) {
+    return ends.size() * sizeof(u64) + (ends.empty() ? 0 : ends.back());
+}
+
+// Write a section of blocks: the end of each block as a u64, then the blocks.
+// Each block starts its differences from 0, so that it can be decoded on its
+// own.
+template <class Encode>
+void write_blocks(FileWriter& file, const u64 n, const std::vector<u64>& ends, Encode&& encode) {
+    file.write(ends.data(), ends.size() * sizeof(u64));
+    for (u64 block = 0; block < ends.size(); block++) {
+        encode(file, block * block_length, std::min((block + 1) * block_length, n));
+    }
+}
+
+// Decode the blocks of a section written by `write_blocks` in parallel with
+// `decode(reader, begin, end)`. Returns false if any block is malformed.
+template <class Decode>
+bool decode_blocks(const char* data, const u64 size, const u64 n, Decode&& decode) {
+    const u64 n_table = n_blocks(n);
+    if (n_table > UINT32_MAX || size < n_table * sizeof(u64)) {
+        return false;
+    }
+    const u8* blocks = reinterpret_cast<const u8*>(data) + n_table * sizeof(u64);
+    const u64 blocks_end = size - n_table * sizeof(u64);
+
+    std::atomic<bool> valid = true;
+    parallel_for("decode blocks", (u32)n_table, hardware_threads(), [&](u32 block, u32) {
+        u64 begin_byte = 0;
+        u64 end_byte;
+        if (block > 0) {
+            memcpy(&begin_byte, data + (block - 1) * sizeof(u64), sizeof(u64));
+        }
+        memcpy(&end_byte, data + block * sizeof(u64), sizeof(u64));
+        if (begin_byte > end_byte || end_byte > blocks_end) {
+            valid.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        VarintReader reader = {blocks + begin_byte, blocks + end_byte};
+        const u64 begin = block * block_length;
+        if (!decode(reader, begin, std::min(begin + block_length, n)) || reader.pos != reader.end) {
+            valid.store(false, std::memory_order_relaxed);
+        }
+    });
+    return valid;
+}
+
+// The number of leading `tet_vertices` of `mesh` that are copies of its
+// `vertices`.
+u64 n_shared_points(const Mesh4& mesh) {
+    const size_t n = std::min(mesh.vertices.size(), mesh.tet_vertices.size());
+    u64 result = 0;
+    while (result < n && mesh.tet_vertices[result] == mesh.vertices[result]) {
+        result++;
+    }
+    return result;
+}
+
+// The bounds of the quantized points of a `points_encoding` section.
+struct QuantizedBounds {
+    f64 min[4];
+    f64 step[4];
+};
+
+QuantizedBounds quantized_bounds(const Mesh4& mesh, const u64 n_shared, const u32 bits) {
+    QuantizedBounds bounds;
+    f64 max[4];
+    for (s32 i = 0; i < 4; i++) {
+        bounds.min[i] = DBL_MAX;
+        max[i] = -DBL_MAX;
+    }
+    for (size_t j = n_shared; j < mesh.tet_vertices.size(); j++) {
+        for (s32 i = 0; i < 4; i++) {
+            bounds.min[i] = std::min(bounds.min[i], mesh.tet_vertices[j][i]);
+            max[i] = std::max(max[i], mesh.tet_vertices[j][i]);
+        }
+    }
+    const f64 n_steps = (f64)((1ull << bits) - 1);
+    for (s32 i = 0; i < 4; i++) {
+        if (bounds.min[i] > max[i]) {
+            bounds.min[i] = 0.0;
+            max[i] = 0.0;
+        }
+        bounds.step[i] = (max[i] - bounds.min[i]) / n_steps;
+    }
+    return bounds;
+}
+
+u64 points_size(const Mesh4& mesh, const u64 n_shared, const u32 bits) {
+    const u64 n = mesh.tet_vertices.size() - n_shared;
+    if (bits == 0) {
+        return sizeof(u64) + n * sizeof(glm::dvec4);
+    }
+    return sizeof(u64) + sizeof(QuantizedBounds) + n * 4 * (bits / 8);
+}
+
+void write_points(FileWriter& file, const Mesh4& mesh, const u64 n_shared, const u32 bits) {
+    file.write(&n_shared, sizeof(n_shared));
+    if (bits == 0) {
+        file.write(mesh.tet_vertices.data() + n_shared, (mesh.tet_vertices.size() - n_shared) * sizeof(glm::dvec4));
+        return;
+    }
+
+    const QuantizedBounds bounds = quantized_bounds(mesh, n_shared, bits);
+    file.write(&bounds, sizeof(bounds));
+    // Rounded in 64 bits, since `long` may be too narrow for 32-bit codes.
+    const s64 max_code = (s64)((1ull << bits) - 1);
+    for (size_t j = n_shared; j < mesh.tet_vertices.size(); j++) {
+        for (s32 i = 0; i < 4; i++) {
+            const f64 step = bounds.step[i];
+            const s64 rounded = step > 0.0 ? std::llround((mesh.tet_vertices[j][i] - bounds.min[i]) / step) : 0;
+            const u32 code = (u32)std::clamp(rounded, (s64)0, max_code);
+            if (bits == 16) {
+                const u16 code16 = (u16)code;
+                file.write(&code16, sizeof(code16));
+            } else {
+                file.write(&code, sizeof(code));
+            }
+        }
+    }
+}
+
+bool read_points(const char* data, const u64 size, const u64 count, const u32 bits,
+                 const MappedArray<glm::dvec4>& vertices, std::vector<glm::dvec4>& out) {
+    u64 n_shared;
+    if (size < sizeof(u64)) {
+        return false;
+    }
+    memcpy(&n_shared, data, sizeof(u64));
+    if (n_shared > count || n_shared > vertices.size) {
+        return false;
+    }
+
+    const u64 n = count - n_shared;
+    if (n > size) {
+        return false;
+    }
+    const u64 expected_size = bits == 0 ? sizeof(u64) + n * sizeof(glm::dvec4)
+                                        : sizeof(u64) + sizeof(QuantizedBounds) + n * 4 * (bits / 8);
+    if (size != expected_size) {
+        return false;
+    }
+
+    out.resize(count);
+    std::copy(vertices.begin(), vertices.begin() + n_shared, out.begin());
+    data += sizeof(u64);
+    if (bits == 0) {
+        memcpy(out.data() + n_shared, data, n * sizeof(glm::dvec4));
+        return true;
+    }
+
+    QuantizedBounds bounds;
+    memcpy(&bounds, data, sizeof(bounds));
+    data += sizeof(bounds);
+    for (u64 j = 0; j < n; j++) {
+        for (s32 i = 0; i < 4; i++) {
+            u32 code;
+            if (bits == 16) {
+                u16 code16;
+                memcpy(&code16, data, sizeof(code16));
+                code = code16;
+            } else {
+                memcpy(&code, data, sizeof(code));
+            }
+            data += bits / 8;
+            out[n_shared + j][i] = bounds.min[i] + (f64)code * bounds.step[i];
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+MappedMesh4::~MappedMesh4() {
+    close();
+}
+
+void MappedMesh4::close() {
+#ifndef __WIN32__
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#else
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+#endif
+    data_ = NULL;
+    size_ = 0;
+
+    compressed = false;
+    name = {};
+    vertices = {};
+    edges = {};
+    face_offsets = {};
+    face_indices = {};
+    cell_offsets = {};
+    cell_indices = {};
+    tet_vertices = {};
+    tets = {};
+}
+
+bool MappedMesh4::open(const char* path) {
+    close();
+
+#ifndef __WIN32__
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_F(ERROR, "Could not open %s", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(FileHeader)) {
+        LOG_F(ERROR, "%s is not a binary mesh file", path);
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_F(ERROR, "Could not map %s", path);
+        return false;
+    }
+    data_ = static_cast<const char*>(mapping);
+    size_ = (size_t)info.st_size;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        LOG_F(ERROR, "Could not open %s", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (file_size < (long)sizeof(FileHeader)) {
+        LOG_F(ERROR, "%s is not a binary mesh file", path);
+        fclose(file);
+        return false;
+    }
+    buffer_.resize(((size_t)file_size + sizeof(u64) - 1) / sizeof(u64));
+    const bool read = fread(buffer_.data(), 1, (size_t)file_size, file) == (size_t)file_size;
+    fclose(file);
+    if (!read) {
+        LOG_F(ERROR, "Could not read %s", path);
+        close();
+        return false;
+    }
+    data_ = reinterpret_cast<const char*>(buffer_.data());
+    size_ = (size_t)file_size;
+#endif
+
+    FileHeader header;
+    memcpy(&header, data_, sizeof(header));
+    if (memcmp(header.magic, file_magic, sizeof(file_magic)) != 0) {
+        LOG_F(ERROR, "%s is not a binary mesh file", path);
+        close();
+        return false;
+    }
+    if (header.version != format_version || header.header_size != sizeof(FileHeader)) {
+        LOG_F(ERROR, "%s has unsupported binary mesh version %u", path, header.version);
+        close();
+        return false;
+    }
+    if (header.file_size != size_) {
+        LOG_F(ERROR, "%s is truncated", path);
+        close();
+        return false;
+    }
+
+    // The encodings each section may have.
+    constexpr Encoding encodings[n_sections] = {
+            raw_encoding,    raw_encoding,    raw_encoding,    lists_encoding, lists_encoding,
+            lists_encoding,  lists_encoding,  points_encoding, tets_encoding,
+    };
+
+    bool valid_table = true;
+    for (u32 i = 0; i < n_sections; i++) {
+        const FileSection& section = header.sections[i];
+        valid_table = valid_table && section.offset >= sizeof(FileHeader) && section.offset % section_alignment == 0
+                      && section.offset <= size_ && section.size <= size_ - section.offset;
+        if (section.encoding == raw_encoding) {
+            valid_table = valid_table && section.count <= section.size / element_sizes[i]
+                          && section.size == section.count * element_sizes[i];
+        } else {
+            valid_table = valid_table && section.encoding == encodings[i];
+            compressed = true;
+        }
+    }
+    for (const Section s : {face_offsets_section, cell_offsets_section}) {
+        // The offsets and indices of faces or cells are compressed together.
+        const FileSection& offsets_section = header.sections[s];
+        const FileSection& indices_section = header.sections[s + 1];
+        valid_table = valid_table && offsets_section.encoding == indices_section.encoding
+                      && (indices_section.encoding == raw_encoding || indices_section.size == 0);
+    }
+    const u32 bits = header.sections[tet_vertices_section].parameter;
+    valid_table = valid_table && (bits == 0 || bits == 16 || bits == 32);
+    if (!valid_table) {
+        LOG_F(ERROR, "%s has an invalid section table", path);
+        close();
+        return false;
+    }
+
+    const auto section = [&](auto& array, Section s) {
+        if (header.sections[s].encoding != raw_encoding) {
+            return;
+        }
+        using T = std::remove_reference_t<decltype(*array.data)>;
+        array.data = static_cast<const T*>(static_cast<const void*>(data_ + header.sections[s].offset));
+        array.size = header.sections[s].count;
+    };
+
+    name = std::string_view(data_ + header.sections[name_section].offset, header.sections[name_section].count);
+    section(vertices, vertices_section);
+    section(edges, edges_section);
+    section(face_offsets, face_offsets_section);
+    section(face_indices, face_indices_section);
+    section(cell_offsets, cell_offsets_section);
+    section(cell_indices, cell_indices_section);
+    section(tet_vertices, tet_vertices_section);
+    section(tets, tets_section);
+
+    // Compressed sections are checked as they are decoded.
+    if (compressed) {
+        return true;
+    }
+
+    bool valid = true;
+    for (const Edge& e : edges) {
+        valid = valid && e.v0 < vertices.size && e.v1 < vertices.size;
+    }
+    valid = valid && valid_index_lists(face_offsets, face_indices, edges.size)
+            && valid_index_lists(cell_offsets, cell_indices, n_faces());
+    for (const Mesh4::Tet& tet : tets) {
+        valid = valid && tet.cell < n_cells();
+        for (u32 v : tet.vertices) {
+            valid = valid && v < tet_vertices.size;
+        }
+    }
+    if (!valid) {
+        LOG_F(ERROR, "%s has an index out of range", path);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool MappedMesh4::to_mesh(Mesh4& out) const {
+    out.name.assign(name.begin(), name.end());
+    out.vertices.assign(vertices.begin(), vertices.end());
+    out.edges.assign(edges.begin(), edges.end());
+
+    if (!compressed) {
+        out.faces.resize(n_faces());
+        for (size_t i = 0; i < out.faces.size(); i++) {
+            const MappedArray<u32> face_i = face(i);
+            out.faces[i].assign(face_i.begin(), face_i.end());
+        }
+
+        out.cells.resize(n_cells());
+        for (size_t i = 0; i < out.cells.size(); i++) {
+            const MappedArray<u32> cell_i = cell(i);
+            out.cells[i].assign(cell_i.begin(), cell_i.end());
+        }
+
+        out.tet_vertices.assign(tet_vertices.begin(), tet_vertices.end());
+        out.tets.assign(tets.begin(), tets.end());
+        return true;
+    }
+
+    FileHeader header;
+    memcpy(&header, data_, sizeof(header));
+    const auto section_data = [&](Section s) { return data_ + header.sections[s].offset; };
+
+    bool valid = true;
+    const auto read_lists = [&](Section offsets_section, Section indices_section,
+                                std::vector<std::vector<u32>>& lists) {
+        const FileSection& section = header.sections[offsets_section];
+        if (section.encoding == raw_encoding) {
+            const MappedArray<u32>& offsets = offsets_section == face_offsets_section ? face_offsets : cell_offsets;
+            const MappedArray<u32>& indices = indices_section == face_indices_section ? face_indices : cell_indices;
+            valid = valid && valid_index_lists(offsets, indices, UINT32_MAX);
+            lists.resize(valid ? offsets.size - 1 : 0);
+            for (size_t i = 0; i < lists.size(); i++) {
+                lists[i].assign(indices.begin() + offsets[i], indices.begin() + offsets[i + 1]);
+            }
+            return;
+        }
+
+        // The section counts the offsets, one more than the lists. Each list
+        // takes at least a byte, so a larger count is malformed.
+        valid = valid && section.count > 0 && section.count - 1 <= section.size;
+        lists.resize(valid ? section.count - 1 : 0);
+        valid = valid
+                && decode_blocks(section_data(offsets_section), section.size, lists.size(),
+                                 [&](VarintReader& reader, u64 begin, u64 end) {
+                                     return decode_lists(reader, lists, begin, end);
+                                 });
+    };
+
+    read_lists(face_offsets_section, face_indices_section, out.faces);
+    read_lists(cell_offsets_section, cell_indices_section, out.cells);
+
+    const FileSection& points = header.sections[tet_vertices_section];
+    if (points.encoding == raw_encoding) {
+        out.tet_vertices.assign(tet_vertices.begin(), tet_vertices.end());
+    } else {
+        valid = valid
+                && read_points(section_data(tet_vertices_section), points.size, points.count, points.parameter,
+                               vertices, out.tet_vertices);
+    }
+
+    const FileSection& tets_info = header.sections[tets_section];
+    if (tets_info.encoding == raw_encoding) {
+        out.tets.assign(tets.begin(), tets.end());
+    } else {
+        valid = valid && tets_info.count <= tets_info.size;
+        out.tets.resize(valid ? tets_info.count : 0);
+        valid = valid
+                && decode_blocks(section_data(tets_section), tets_info.size, tets_info.count,
+                                 [&](VarintReader& reader, u64 begin, u64 end) {
+                                     return decode_tets(reader, out.tets, begin, end);
+                                 });
+    }
+
+    if (!valid) {
+        LOG_F(ERROR, "%s has a malformed compressed section", out.name.c_str());
+        return false;
+    }
+    if (!valid_indices(out)) {
+        LOG_F(ERROR, "%s has an index out of range", out.name.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool is_binary_mesh_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    char magic[sizeof(file_magic)];
+    const bool result = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+                        && memcmp(magic, file_magic, sizeof(magic)) == 0;
+    fclose(file);
+    return result;
+}
+
+bool save_mesh_binary(const Mesh4& mesh, const char* path, const BinaryMeshOptions& options) {
+    const u64 n_face_indices = total_size(mesh.faces);
+    const u64 n_cell_indices = total_size(mesh.cells);
+    if (n_face_indices > UINT32_MAX || n_cell_indices > UINT32_MAX) {
+        LOG_F(ERROR, "%s has too many face or cell indices for a binary mesh file", mesh.name.c_str());
+        return false;
+    }
+    if (options.quantize_bits != 0 && options.quantize_bits != 16 && options.quantize_bits != 32) {
+        LOG_F(ERROR, "Cannot quantize to %u bits", options.quantize_bits);
+        return false;
+    }
+
+    const u64 section_counts[n_sections] = {
+            mesh.name.size(),     mesh.vertices.size(), mesh.edges.size(),
+            mesh.faces.size() + 1, n_face_indices,      mesh.cells.size() + 1,
+            n_cell_indices,       mesh.tet_vertices.size(), mesh.tets.size(),
+    };
+
+    FileHeader header = {};
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = format_version;
+    header.header_size = sizeof(FileHeader);
+    for (u32 i = 0; i < n_sections; i++) {
+        header.sections[i].count = section_counts[i];
+        header.sections[i].size = section_counts[i] * element_sizes[i];
+    }
+
+    // Compressed sections are encoded twice: once to measure them, so that
+    // the header can be written first, and once as they are written.
+    const auto encode_faces = [&](auto& sink, u64 begin, u64 end) { encode_lists(sink, mesh.faces, begin, end); };
+    const auto encode_cells = [&](auto& sink, u64 begin, u64 end) { encode_lists(sink, mesh.cells, begin, end); };
+    const auto encode_tets_blocks = [&](auto& sink, u64 begin, u64 end) { encode_tets(sink, mesh.tets, begin, end); };
+
+    std::vector<u64> face_ends;
+    std::vector<u64> cell_ends;
+    std::vector<u64> tet_ends;
+    u64 n_shared = 0;
+    u32 bits = 0;
+    if (options.compress) {
+        face_ends = block_ends(mesh.faces.size(), encode_faces);
+        cell_ends = block_ends(mesh.cells.size(), encode_cells);
+        tet_ends = block_ends(mesh.tets.size(), encode_tets_blocks);
+        n_shared = n_shared_points(mesh);
+        // Only the points that are not copies of `vertices` are quantized, so
+        // without any there is nothing to gain.
+        bits = n_shared < mesh.tet_vertices.size() ? options.quantize_bits : 0;
+
+        const auto set_encoding = [&](Section s, Encoding encoding, u64 size) {
+            header.sections[s].encoding = encoding;
+            header.sections[s].size = size;
+        };
+        set_encoding(face_offsets_section, lists_encoding, blocks_size(face_ends));
+        set_encoding(face_indices_section, lists_encoding, 0);
+        set_encoding(cell_offsets_section, lists_encoding, blocks_size(cell_ends));
+        set_encoding(cell_indices_section, lists_encoding, 0);
+        set_encoding(tet_vertices_section, points_encoding, points_size(mesh, n_shared, bits));
+        header.sections[tet_vertices_section].parameter = bits;
+        set_encoding(tets_section, tets_encoding, blocks_size(tet_ends));
+    }
+
+    u64 offset = sizeof(FileHeader);
+    for (u32 i = 0; i < n_sections; i++) {
+        offset = align_up(offset);
+        header.sections[i].offset = offset;
+        offset += header.sections[i].size;
+    }
+    header.file_size = offset;
+
+    FileWriter file;
+    if (!file.open(path)) {
+        LOG_F(ERROR, "Could not open %s for writing", path);
+        return false;
+    }
+
+    // Faces and cells are converted to CSR form as they are written, so no
+    // flattened copy of them is made.
+    u64 position = 0;
+    const auto start_section = [&](Section s) {
+        file.pad(header.sections[s].offset - position);
+        position = header.sections[s].offset + header.sections[s].size;
+    };
+    const auto write_vector = [&](Section s, const auto& values) {
+        start_section(s);
+        file.write(values.data(), values.size() * sizeof(values[0]));
+    };
+    const auto write_index_lists = [&](Section offsets_section, Section indices_section,
+                                       const std::vector<std::vector<u32>>& lists) {
+        start_section(offsets_section);
+        u32 list_offset = 0;
+        file.write(&list_offset, sizeof(list_offset));
+        for (const auto& list : lists) {
+            list_offset += (u32)list.size();
+            file.write(&list_offset, sizeof(list_offset));
+        }
+
+        start_section(indices_section);
+        for (const auto& list : lists) {
+            file.write(list.data(), list.size() * sizeof(u32));
+        }
+    };
+
+    file.write(&header, sizeof(header));
+    position = sizeof(header);
+    write_vector(name_section, mesh.name);
+    write_vector(vertices_section, mesh.vertices);
+    write_vector(edges_section, mesh.edges);
+
+    if (options.compress) {
+        start_section(face_offsets_section);
+        write_blocks(file, mesh.faces.size(), face_ends, encode_faces);
+        start_section(face_indices_section);
+        start_section(cell_offsets_section);
+        write_blocks(file, mesh.cells.size(), cell_ends, encode_cells);
+        start_section(cell_indices_section);
+        start_section(tet_vertices_section);
+        write_points(file, mesh, n_shared, bits);
+        start_section(tets_section);
+        write_blocks(file, mesh.tets.size(), tet_ends, encode_tets_blocks);
+    } else {
+        write_index_lists(face_offsets_section, face_indices_section, mesh.faces);
+        write_index_lists(cell_offsets_section, cell_indices_section, mesh.cells);
+        write_vector(tet_vertices_section, mesh.tet_vertices);
+        write_vector(tets_section, mesh.tets);
+    }
+
+    if (!file.close()) {
+        LOG_F(ERROR, "Could not write %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool load_mesh_binary(const char* path, Mesh4& out) {
+    MappedMesh4 mapped;
+    if (!mapped.open(path)) {
+        return false;
+    }
+    if (!mapped.to_mesh(out)) {
+        LOG_F(ERROR, "Could not load %s", path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace four
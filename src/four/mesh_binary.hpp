@@ -0,0 +1,143 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+#include <string_view>
+
+namespace four {
+
+// Binary mesh files hold the same data as the XML `.mesh4` format, laid out
+// so that it can be used straight from a memory mapping. All values are
+// little-endian. The file starts with a fixed header: a magic string, the
+// format version, the header size, the file size and a table of sections,
+// each an offset into the file, a size in bytes, a number of elements and an
+// encoding. The sections, each aligned to 64 bytes, are:
+//
+// * the mesh name, as bytes without a terminator,
+// * `vertices`, as 4 f64s each,
+// * `edges`, as 2 u32s each,
+// * `faces`, as n + 1 u32 offsets into a u32 array of edge indices,
+// * `cells`, the same way, into an array of face indices,
+// * `tet_vertices`, as 4 f64s each,
+// * `tets`, as a u32 cell index and 4 u32 vertex indices each.
+//
+// Faces and cells are stored in compressed sparse row form: face `i` is the
+// indices from `face_offsets[i]` up to `face_offsets[i + 1]`.
+//
+// Each section also records its encoding. Uncompressed sections are laid out
+// as above. Compressed files instead store faces, cells and tets in blocks
+// of a few thousand, as varints of the difference between each index and the
+// one before it. A table of block offsets lets the blocks be decoded in
+// parallel. The `tet_vertices` that are copies of `vertices` are left out,
+// and the rest may be quantized.
+inline constexpr char binary_mesh_extension[] = ".mesh4b";
+
+struct BinaryMeshOptions {
+
+    // Write faces, cells and tets compressed, and leave out the copy of
+    // `vertices` at the start of `tet_vertices`.
+    bool compress = false;
+
+    // If 16 or 32, and `compress` is set, store the `tet_vertices` that are
+    // not copies of `vertices` with this many bits per coordinate, spread
+    // evenly over their bounding box. This loses precision. If 0, they are
+    // stored exactly. Those points are TetGen's Steiner points, so this has
+    // no effect on meshes whose cells are all convex.
+    u32 quantize_bits = 0;
+};
+
+// A contiguous read-only array inside a `MappedMesh4`.
+template <class T>
+struct MappedArray {
+    const T* data = NULL;
+    size_t size = 0;
+
+    const T* begin() const noexcept {
+        return data;
+    }
+
+    const T* end() const noexcept {
+        return data + size;
+    }
+
+    const T& operator[](size_t index) const noexcept {
+        DCHECK_LT_F(index, size);
+        return data[index];
+    }
+};
+
+// A binary mesh file mapped into memory. Opening an uncompressed file checks
+// the header and every index, but copies and converts nothing: the arrays
+// point into the mapping, and stay valid until the `MappedMesh4` is destroyed.
+// In a compressed file, only the uncompressed sections can be used in place;
+// the arrays of the others are empty, and `to_mesh` decodes them.
+class MappedMesh4 {
+private:
+    const char* data_ = NULL;
+    size_t size_ = 0;
+
+#ifdef __WIN32__
+    // Windows builds read the file instead of mapping it.
+    std::vector<u64> buffer_;
+#endif
+
+public:
+    bool compressed = false;
+
+    std::string_view name;
+    MappedArray<glm::dvec4> vertices;
+    MappedArray<Edge> edges;
+    MappedArray<u32> face_offsets;
+    MappedArray<u32> face_indices;
+    MappedArray<u32> cell_offsets;
+    MappedArray<u32> cell_indices;
+    MappedArray<glm::dvec4> tet_vertices;
+    MappedArray<Mesh4::Tet> tets;
+
+    MappedMesh4() = default;
+    MappedMesh4(const MappedMesh4&) = delete;
+    MappedMesh4& operator=(const MappedMesh4&) = delete;
+    ~MappedMesh4();
+
+    // Map the binary mesh file at `path`. Returns false and logs an error if
+    // it cannot be read or is not a valid binary mesh file.
+    bool open(const char* path);
+
+    size_t n_faces() const {
+        return face_offsets.size == 0 ? 0 : face_offsets.size - 1;
+    }
+
+    size_t n_cells() const {
+        return cell_offsets.size == 0 ? 0 : cell_offsets.size - 1;
+    }
+
+    MappedArray<u32> face(size_t index) const {
+        return {face_indices.data + face_offsets[index], face_offsets[index + 1] - face_offsets[index]};
+    }
+
+    MappedArray<u32> cell(size_t index) const {
+        return {cell_indices.data + cell_offsets[index], cell_offsets[index + 1] - cell_offsets[index]};
+    }
+
+    // Copy the mapped mesh into `out`, decoding any compressed sections in
+    // parallel. Every uncompressed array but the faces and cells is copied in
+    // one block. Returns false and logs an error if a compressed section is
+    // malformed or holds an index out of range.
+    bool to_mesh(Mesh4& out) const;
+
+private:
+    void close();
+};
+
+// Whether the file at `path` starts like a binary mesh file.
+bool is_binary_mesh_file(const char* path);
+
+// Write `mesh` to `path` in the binary format. Returns false and logs an error
+// if the file cannot be written.
+bool save_mesh_binary(const Mesh4& mesh, const char* path, const BinaryMeshOptions& options = {});
+
+// Read the binary mesh file at `path` into `out`. Returns false and logs an
+// error if the file cannot be read or is not valid.
+bool load_mesh_binary(const char* path, Mesh4& out);
+
+} // namespace four
@@ -0,0 +1,416 @@
+#include <four/mesh_cache.hpp>
+
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef __WIN32__
+#    include <unistd.h>
+#else
+#    include <process.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace four {
+
+namespace {
+
+// Bump when the output of a generator or the entry format changes, so that
+// stale entries are never loaded.
+constexpr u32 cache_version = 4;
+
+constexpr char entry_magic[8] = {'f', 'o', 'u', 'r', '-', 'm', 'c', '\0'};
+constexpr const char* entry_extension = ".mesh4c";
+
+// A temporary file name next to `path` that no other writer uses at the same
+// time: the process id tells apart processes sharing the cache, and a counter
+// the writers within one.
+std::string unique_temp_path(const std::string& path) {
+    static std::atomic<u32> counter = 0;
+#ifndef __WIN32__
+    const long pid = (long)getpid();
+#else
+    const long pid = (long)_getpid();
+#endif
+    return strprintf("%s.%ld-%u.tmp", path.c_str(), pid, counter.fetch_add(1, std::memory_order_relaxed));
+}
+
+// 64-bit FNV-1a.
+u64 fnv1a(const void* data, const size_t size, u64 hash = 14695981039346656037ull) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Serializes values into a byte buffer.
+struct Writer {
+    std::vector<char> bytes;
+
+    template <class T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const char* p = reinterpret_cast<const char*>(&value);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+
+    template <class T>
+    void put_vector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const u64 n = values.size();
+        put(n);
+        const char* p = reinterpret_cast<const char*>(values.data());
+        bytes.insert(bytes.end(), p, p + values.size() * sizeof(T));
+    }
+
+    void put_string(const std::string& str) {
+        const u64 n = str.size();
+        put(n);
+        bytes.insert(bytes.end(), str.begin(), str.end());
+    }
+
+    // A vector of faces or cells, as the size of each followed by its indices.
+    void put_index_lists(const std::vector<std::vector<u32>>& lists) {
+        const u64 n = lists.size();
+        put(n);
+        for (const auto& list : lists) {
+            put((u32)list.size());
+            const char* p = reinterpret_cast<const char*>(list.data());
+            bytes.insert(bytes.end(), p, p + list.size() * sizeof(u32));
+        }
+    }
+};
+
+// Deserializes values written by `Writer`. Every read checks that the data is
+// long enough, so a truncated or corrupt entry makes a read fail rather than
+// overrun the buffer.
+struct Reader {
+    const char* pos;
+    const char* end;
+
+    size_t remaining() const {
+        return (size_t)(end - pos);
+    }
+
+    template <class T>
+    bool get(T& out) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (remaining() < sizeof(T)) {
+            return false;
+        }
+        memcpy(&out, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    template <class T>
+    bool get_vector(std::vector<T>& out) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        u64 n;
+        if (!get(n) || n > remaining() / sizeof(T)) {
+            return false;
+        }
+        out.resize(n);
+        memcpy(out.data(), pos, n * sizeof(T));
+        pos += n * sizeof(T);
+        return true;
+    }
+
+    bool get_string(std::string& out) {
+        u64 n;
+        if (!get(n) || n > remaining()) {
+            return false;
+        }
+        out.assign(pos, n);
+        pos += n;
+        return true;
+    }
+
+    bool get_index_lists(std::vector<std::vector<u32>>& out, const size_t index_end) {
+        u64 n;
+        if (!get(n) || n > remaining() / sizeof(u32)) {
+            return false;
+        }
+        out.resize(n);
+        for (auto& list : out) {
+            u32 size;
+            if (!get(size) || size > remaining() / sizeof(u32)) {
+                return false;
+            }
+            list.resize(size);
+            memcpy(list.data(), pos, size * sizeof(u32));
+            pos += size * sizeof(u32);
+
+            for (u32 index : list) {
+                if (index >= index_end) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+void write_entry(const std::string& key, const Mesh4& mesh, Writer& w) {
+    w.put(entry_magic);
+    w.put(cache_version);
+    w.put_string(key);
+    w.put_string(mesh.name);
+    w.put_vector(mesh.vertices);
+    w.put_vector(mesh.edges);
+    w.put_index_lists(mesh.faces);
+    w.put_index_lists(mesh.cells);
+    w.put_vector(mesh.tet_vertices);
+    w.put_vector(mesh.tets);
+}
+
+// Returns false if the entry is corrupt or has a different key.
+bool read_entry(const std::string& key, Reader& r, Mesh4& out) {
+    char magic[sizeof(entry_magic)];
+    u32 version;
+    std::string entry_key;
+    if (!r.get(magic) || memcmp(magic, entry_magic, sizeof(magic)) != 0 || !r.get(version)
+        || version != cache_version || !r.get_string(entry_key) || entry_key != key) {
+        return false;
+    }
+
+    if (!r.get_string(out.name) || !r.get_vector(out.vertices) || !r.get_vector(out.edges)) {
+        return false;
+    }
+    for (const Edge& e : out.edges) {
+        if (e.v0 >= out.vertices.size() || e.v1 >= out.vertices.size()) {
+            return false;
+        }
+    }
+
+    if (!r.get_index_lists(out.faces, out.edges.size()) || !r.get_index_lists(out.cells, out.faces.size())
+        || !r.get_vector(out.tet_vertices) || !r.get_vector(out.tets)) {
+        return false;
+    }
+    for (const Mesh4::Tet& tet : out.tets) {
+        if (tet.cell >= out.cells.size()) {
+            return false;
+        }
+        for (u32 v : tet.vertices) {
+            if (v >= out.tet_vertices.size()) {
+                return false;
+            }
+        }
+    }
+
+    return r.remaining() == 0;
+}
+} // namespace
+
+MeshCache::MeshCache(std::string dir, const u64 max_bytes) : dir_(std::move(dir)), max_bytes_(max_bytes) {
+    std::error_code error;
+    fs::create_directories(dir_, error);
+    if (error) {
+        LOG_F(WARNING, "Could not create mesh cache directory %s: %s", dir_.c_str(), error.message().c_str());
+    }
+}
+
+bool MeshCache::make_key(const char* spec, const GenerateOptions& options, std::string& out) {
+    out = strprintf("four mesh cache %u\nspec %s\ncell search %i\ntet mode %i\ntetgen %s\n", cache_version, spec,
+                    (s32)options.cell_search, (s32)options.tet_mode, tetgen_switches);
+
+    // The mesh depends on the contents of a point file, not just its path.
+    // Operators such as "dual:" come before the spec they apply to.
+    const char* hull = spec;
+    for (bool skipped = true; skipped;) {
+        skipped = false;
+        for (const char* op : {"dual:", "truncate:", "rectify:", "bitruncate:"}) {
+            if (strncmp(hull, op, strlen(op)) == 0) {
+                hull += strlen(op);
+                skipped = true;
+            }
+        }
+    }
+    if (strncmp(hull, "hull:", 5) == 0) {
+        std::vector<char> contents;
+        if (!read_file(hull + 5, contents)) {
+            return false;
+        }
+        out += strprintf("file %016llx %lu\n", (unsigned long long)fnv1a(contents.data(), contents.size()),
+                         contents.size());
+    }
+
+    return true;
+}
+
+std::string MeshCache::entry_path(const std::string& key) const {
+    const u64 hash = fnv1a(key.data(), key.size());
+    return (fs::path(dir_) / strprintf("%016llx%s", (unsigned long long)hash, entry_extension)).string();
+}
+
+bool MeshCache::load(const std::string& key, Mesh4& out) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::string path = entry_path(key);
+
+    std::vector<char> bytes;
+    bool hit = read_file(path.c_str(), bytes);
+    if (hit) {
+        Reader reader = {bytes.data(), bytes.data() + bytes.size()};
+        Mesh4 mesh;
+        hit = read_entry(key, reader, mesh);
+        if (hit) {
+            out = std::move(mesh);
+        } else {
+            LOG_F(WARNING, "Ignoring invalid mesh cache entry %s", path.c_str());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hit) {
+        // Mark the entry as recently used.
+        std::error_code error;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+        hits_++;
+        const f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+        LOG_F(INFO, "Mesh cache hit for %s in %.1f ms (%llu hits, %llu misses)", out.name.c_str(), ms,
+              (unsigned long long)hits_, (unsigned long long)misses_);
+    } else {
+        misses_++;
+        LOG_F(INFO, "Mesh cache miss (%llu hits, %llu misses)", (unsigned long long)hits_,
+              (unsigned long long)misses_);
+    }
+
+    return hit;
+}
+
+void MeshCache::store(const std::string& key, const Mesh4& mesh) {
+    Writer writer;
+    write_entry(key, mesh, writer);
+
+    if (writer.bytes.size() > max_bytes_) {
+        LOG_F(INFO, "Not caching %s: its %lu bytes exceed the cache size limit", mesh.name.c_str(),
+              writer.bytes.size());
+        return;
+    }
+
+    // Write to a temporary file of our own first, so that other writers of the
+    // same entry, in this process or another, never see or publish a partly
+    // written one.
+    const std::string path = entry_path(key);
+    const std::string temp_path = unique_temp_path(path);
+
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        LOG_F(WARNING, "Could not write mesh cache entry %s", temp_path.c_str());
+        return;
+    }
+    const bool written = fwrite(writer.bytes.data(), 1, writer.bytes.size(), file) == writer.bytes.size();
+    const bool closed = fclose(file) == 0;
+
+    std::error_code error;
+    if (!written || !closed) {
+        LOG_F(WARNING, "Could not write mesh cache entry %s", temp_path.c_str());
+        fs::remove(temp_path, error);
+        return;
+    }
+
+    fs::rename(temp_path, path, error);
+    if (error) {
+        LOG_F(WARNING, "Could not write mesh cache entry %s: %s", path.c_str(), error.message().c_str());
+        fs::remove(temp_path, error);
+        return;
+    }
+
+    LOG_F(INFO, "Cached %s (%lu bytes)", mesh.name.c_str(), writer.bytes.size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict();
+}
+
+// Delete the least recently used entries until the rest fit in `max_bytes_`.
+void MeshCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type last_used;
+        u64 size;
+    };
+
+    std::vector<Entry> entries;
+    u64 total = 0;
+
+    std::error_code error;
+    for (const auto& dir_entry : fs::directory_iterator(dir_, error)) {
+        if (dir_entry.path().extension() != entry_extension) {
+            continue;
+        }
+
+        std::error_code entry_error;
+        Entry entry = {dir_entry.path(), dir_entry.last_write_time(entry_error), dir_entry.file_size(entry_error)};
+        if (!entry_error) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    if (total <= max_bytes_) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+
+    for (const Entry& entry : entries) {
+        if (total <= max_bytes_) {
+            break;
+        }
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+            evictions_++;
+            LOG_F(INFO, "Evicted %s from the mesh cache (%llu bytes, %llu evictions)", entry.path.string().c_str(),
+                  (unsigned long long)entry.size, (unsigned long long)evictions_);
+        }
+    }
+}
+
+bool generate_cached(MeshCache* cache, const char* spec, const GenerateOptions& options, Mesh4& out) {
+    std::string key;
+    const bool use_cache = cache && MeshCache::make_key(spec, options, key);
+
+    if (use_cache && cache->load(key, out)) {
+        if (options.progress) {
+            options.progress->n_edges = (u32)out.edges.size();
+            options.progress->n_faces = (u32)out.faces.size();
+            options.progress->n_cells = (u32)out.cells.size();
+            options.progress->n_tetrahedralized_cells = (u32)out.cells.size();
+        }
+        return true;
+    }
+
+    if (!generate_from_spec(spec, options, out)) {
+        return false;
+    }
+
+    // Surface generators emit their own tetrahedra.
+    if (out.tets.empty()) {
+        tetrahedralize(out, options.progress, options.tet_mode);
+        if (options.progress && options.progress->cancelled()) {
+            return false;
+        }
+    }
+
+    if (use_cache) {
+        cache->store(key, out);
+    }
+    return true;
+}
+
+} // namespace four
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <four/generate.hpp>
+#include <four/mesh.hpp>
+
+#include <mutex>
+#include <string>
+
+namespace four {
+
+// An on-disk cache of finished (generated and tetrahedralized) meshes. Each
+// entry is a file named by a hash of its key, which describes everything that
+// determines the mesh: the generator spec, the generate options, the TetGen
+// switches and, for specs that read a file, the file's contents. The full key
+// is stored in the entry and checked on load, so hash collisions are harmless.
+//
+// Entries are used in least-recently-used order of their modification times,
+// which are updated on each hit. When the entries take up more than
+// `max_bytes`, the least recently used are deleted. Safe to use from several
+// threads.
+class MeshCache {
+private:
+    std::mutex mutex_;
+    std::string dir_;
+    u64 max_bytes_;
+
+    u64 hits_ = 0;
+    u64 misses_ = 0;
+    u64 evictions_ = 0;
+
+public:
+    MeshCache(std::string dir, u64 max_bytes);
+
+    // Build the cache key for the mesh generated from `spec` with `options`.
+    // Returns false if a file named by `spec` cannot be read.
+    static bool make_key(const char* spec, const GenerateOptions& options, std::string& out);
+
+    // Load the mesh with the given key into `out`. Returns false on a miss.
+    bool load(const std::string& key, Mesh4& out);
+
+    // Store `mesh` under the given key, then evict entries down to the size
+    // limit. Failures are logged and otherwise ignored.
+    void store(const std::string& key, const Mesh4& mesh);
+
+private:
+    std::string entry_path(const std::string& key) const;
+    void evict();
+};
+
+// Generate and tetrahedralize the mesh named by `spec`, or load it from `cache`
+// if it has been generated before. `cache` may be null. Returns false under
+// the same conditions as `generate_from_spec`.
+bool generate_cached(MeshCache* cache, const char* spec, const GenerateOptions& options, Mesh4& out);
+
+} // namespace four
@@ -0,0 +1,599 @@
+#include <four/mesh_xml.hpp>
+
+#include <four/file_writer.hpp>
+
+#include <loguru.hpp>
+
+#include <string.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+namespace four {
+
+namespace {
+
+bool is_space(const char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool is_name_char(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-'
+           || c == '.' || c == ':';
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && is_space(s.front())) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && is_space(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// Parse all of `s` as a number.
+template <class T>
+bool parse_number(std::string_view s, T& out) {
+    s = trim(s);
+    const char* end = s.data() + s.size();
+    const auto [ptr, error] = std::from_chars(s.data(), end, out);
+    return error == std::errc() && ptr == end;
+}
+
+void append_utf8(u32 code_point, std::string& out) {
+    if (code_point < 0x80) {
+        out.push_back((char)code_point);
+    } else if (code_point < 0x800) {
+        out.push_back((char)(0xc0 | (code_point >> 6)));
+        out.push_back((char)(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+        out.push_back((char)(0xe0 | (code_point >> 12)));
+        out.push_back((char)(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back((char)(0x80 | (code_point & 0x3f)));
+    } else {
+        out.push_back((char)(0xf0 | (code_point >> 18)));
+        out.push_back((char)(0x80 | ((code_point >> 12) & 0x3f)));
+        out.push_back((char)(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back((char)(0x80 | (code_point & 0x3f)));
+    }
+}
+
+// Replace the predefined entities and character references in `text`.
+bool decode_text(std::string_view text, std::string& out) {
+    static constexpr std::pair<std::string_view, char> entities[] = {
+            {"lt", '<'}, {"gt", '>'}, {"amp", '&'}, {"quot", '"'}, {"apos", '\''},
+    };
+
+    out.clear();
+    while (!text.empty()) {
+        const size_t amp = text.find('&');
+        out.append(text.substr(0, amp));
+        if (amp == std::string_view::npos) {
+            break;
+        }
+
+        const size_t semicolon = text.find(';', amp);
+        if (semicolon == std::string_view::npos) {
+            return false;
+        }
+        const std::string_view entity = text.substr(amp + 1, semicolon - amp - 1);
+        text.remove_prefix(semicolon + 1);
+
+        if (entity.size() > 1 && entity[0] == '#') {
+            const bool hex = entity[1] == 'x';
+            const std::string_view digits = entity.substr(hex ? 2 : 1);
+            u32 code_point;
+            const char* end = digits.data() + digits.size();
+            const auto [ptr, error] = std::from_chars(digits.data(), end, code_point, hex ? 16 : 10);
+            if (error != std::errc() || ptr != end || code_point > 0x10ffff) {
+                return false;
+            }
+            append_utf8(code_point, out);
+            continue;
+        }
+
+        const auto it = std::find_if(std::begin(entities), std::end(entities),
+                                     [&](const auto& e) { return e.first == entity; });
+        if (it == std::end(entities)) {
+            return false;
+        }
+        out.push_back(it->second);
+    }
+    return true;
+}
+
+// A pull parser for the subset of XML that `.mesh4` files use: elements with
+// attributes, character data made of numbers, comments, processing
+// instructions and a document type declaration. Every method that can fail
+// logs an error and returns false, and the caller stops there.
+class MeshXmlReader {
+private:
+    const char* path_;
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+
+public:
+    MeshXmlReader(const char* path, const char* begin, const char* end)
+            : path_(path), begin_(begin), pos_(begin), end_(end) {}
+
+    // Log `what` with the current line number. Always returns false.
+    bool error(const char* what) {
+        const u32 line = 1 + (u32)std::count(begin_, pos_, '\n');
+        LOG_F(ERROR, "%s:%u: %s", path_, line, what);
+        return false;
+    }
+
+    std::string_view rest() const {
+        return std::string_view(pos_, (size_t)(end_ - pos_));
+    }
+
+    bool starts_with(std::string_view prefix) const {
+        return rest().substr(0, prefix.size()) == prefix;
+    }
+
+    void skip_space() {
+        while (pos_ < end_ && is_space(*pos_)) {
+            pos_++;
+        }
+    }
+
+    // Skip whitespace, comments, processing instructions such as the XML
+    // declaration, and document type declarations.
+    bool skip_misc() {
+        while (true) {
+            skip_space();
+
+            std::string_view terminator;
+            if (starts_with("<!--")) {
+                terminator = "-->";
+            } else if (starts_with("<?")) {
+                terminator = "?>";
+            } else if (starts_with("<!")) {
+                terminator = ">";
+            } else {
+                return true;
+            }
+
+            const size_t found = rest().find(terminator, 2);
+            if (found == std::string_view::npos) {
+                return error("Unterminated comment or declaration");
+            }
+            pos_ += found + terminator.size();
+        }
+    }
+
+    bool at_end_tag() const {
+        return starts_with("</");
+    }
+
+    bool at_eof() const {
+        return pos_ == end_;
+    }
+
+    // Read `<name`, leaving the attributes to `read_attributes`.
+    bool start_tag(const char* name) {
+        if (!skip_misc()) {
+            return false;
+        }
+        const size_t length = strlen(name);
+        if (!starts_with("<") || rest().substr(1, length) != name || pos_ + 1 + length >= end_
+            || !(is_space(pos_[1 + length]) || pos_[1 + length] == '/' || pos_[1 + length] == '>')) {
+            return error(strprintf("Expected <%s>", name).c_str());
+        }
+        pos_ += 1 + length;
+        return true;
+    }
+
+    // Read the attributes of the current start tag and the `>` or `/>` that
+    // ends it, calling `fn(name, value)` for each attribute. `empty` is set
+    // if the element has no content.
+    template <class Fn>
+    bool read_attributes(Fn&& fn, bool& empty) {
+        while (true) {
+            skip_space();
+            if (pos_ >= end_) {
+                return error("Unexpected end of file");
+            }
+            if (*pos_ == '>') {
+                pos_++;
+                empty = false;
+                return true;
+            }
+            if (starts_with("/>")) {
+                pos_ += 2;
+                empty = true;
+                return true;
+            }
+
+            const char* name_begin = pos_;
+            while (pos_ < end_ && is_name_char(*pos_)) {
+                pos_++;
+            }
+            if (pos_ == name_begin) {
+                return error("Expected an attribute");
+            }
+            const std::string_view name(name_begin, (size_t)(pos_ - name_begin));
+
+            skip_space();
+            if (pos_ >= end_ || *pos_ != '=') {
+                return error("Expected = after attribute name");
+            }
+            pos_++;
+            skip_space();
+            if (pos_ >= end_ || (*pos_ != '"' && *pos_ != '\'')) {
+                return error("Expected a quoted attribute value");
+            }
+
+            const char quote = *pos_;
+            pos_++;
+            const auto* value_end = static_cast<const char*>(memchr(pos_, quote, (size_t)(end_ - pos_)));
+            if (!value_end) {
+                return error("Unterminated attribute value");
+            }
+            const std::string_view value(pos_, (size_t)(value_end - pos_));
+            if (!fn(name, value)) {
+                return false;
+            }
+            pos_ = value_end + 1;
+        }
+    }
+
+    // Read a start tag whose attributes are not used.
+    bool start_element(const char* name, bool& empty) {
+        return start_tag(name) && read_attributes([](std::string_view, std::string_view) { return true; }, empty);
+    }
+
+    bool end_tag(const char* name) {
+        if (!skip_misc()) {
+            return false;
+        }
+        const size_t length = strlen(name);
+        if (!starts_with("</") || rest().substr(2, length) != name) {
+            return error(strprintf("Expected </%s>", name).c_str());
+        }
+        pos_ += 2 + length;
+        skip_space();
+        if (pos_ >= end_ || *pos_ != '>') {
+            return error(strprintf("Expected </%s>", name).c_str());
+        }
+        pos_++;
+        return true;
+    }
+
+    // Read character data holding a single u32.
+    bool text_u32(u32& out) {
+        const auto* text_end = static_cast<const char*>(memchr(pos_, '<', (size_t)(end_ - pos_)));
+        if (!text_end) {
+            return error("Unexpected end of file");
+        }
+        if (!parse_number(std::string_view(pos_, (size_t)(text_end - pos_)), out)) {
+            return error("Expected an unsigned integer");
+        }
+        pos_ = text_end;
+        return true;
+    }
+
+    // Count the `child_tag` tags from here to the next `</name>`. The count is
+    // exact unless a comment holds either tag.
+    size_t count_tags(std::string_view name, std::string_view child_tag) const {
+        size_t count = 0;
+        const char* tag = pos_;
+        while ((tag = static_cast<const char*>(memchr(tag, '<', (size_t)(end_ - tag))))) {
+            const size_t left = (size_t)(end_ - tag);
+            if (left > 2 + name.size() && tag[1] == '/') {
+                if (memcmp(tag + 2, name.data(), name.size()) == 0) {
+                    break;
+                }
+            } else if (left >= child_tag.size() && memcmp(tag, child_tag.data(), child_tag.size()) == 0) {
+                count++;
+            }
+            tag++;
+        }
+        return count;
+    }
+
+    // Read `<name>` and its child elements up to `</name>`, calling
+    // `child()` to read each child into `out`. The children are counted
+    // first, by their `child_tag` tags, so that `out` is allocated once at
+    // its final size.
+    template <class T, class Fn>
+    bool element_list(const char* name, std::vector<T>& out, std::string_view child_tag, Fn&& child) {
+        bool empty;
+        if (!start_element(name, empty)) {
+            return false;
+        }
+        if (empty) {
+            return true;
+        }
+        out.reserve(out.size() + count_tags(name, child_tag));
+        while (true) {
+            if (!skip_misc()) {
+                return false;
+            }
+            if (at_end_tag()) {
+                return end_tag(name);
+            }
+            if (!child()) {
+                return false;
+            }
+        }
+    }
+
+    // Read the end tag of an element that is not empty, if it has no
+    // content.
+    bool finish_element(const char* name, const bool empty) {
+        return empty || end_tag(name);
+    }
+
+    bool read_vec4(std::vector<glm::dvec4>& out) {
+        glm::dvec4 v = {};
+        u32 seen = 0;
+        const auto attribute = [&](std::string_view name, std::string_view value) {
+            if (name.size() != 1 || !strchr("xyzw", name[0])) {
+                return true;
+            }
+            const s32 i = name[0] == 'w' ? 3 : name[0] - 'x';
+            seen |= 1u << i;
+            return parse_number(value, v[i]) || error("Expected a number");
+        };
+
+        bool empty;
+        if (!start_tag("vec4") || !read_attributes(attribute, empty)) {
+            return false;
+        }
+        if (seen != 0xf) {
+            return error("<vec4> is missing a coordinate");
+        }
+        out.push_back(v);
+        return finish_element("vec4", empty);
+    }
+
+    bool read_edge(std::vector<Edge>& out) {
+        Edge e;
+        u32 seen = 0;
+        const auto attribute = [&](std::string_view name, std::string_view value) {
+            const s32 i = name == "v0" ? 0 : name == "v1" ? 1 : -1;
+            if (i < 0) {
+                return true;
+            }
+            seen |= 1u << i;
+            return parse_number(value, e.vertices[i]) || error("Expected an unsigned integer");
+        };
+
+        bool empty;
+        if (!start_tag("edge") || !read_attributes(attribute, empty)) {
+            return false;
+        }
+        if (seen != 0x3) {
+            return error("<edge> is missing a vertex");
+        }
+        out.push_back(e);
+        return finish_element("edge", empty);
+    }
+
+    bool read_tet(std::vector<Mesh4::Tet>& out) {
+        static constexpr std::string_view names[5] = {"cell", "v0", "v1", "v2", "v3"};
+        u32 values[5];
+        u32 seen = 0;
+        const auto attribute = [&](std::string_view name, std::string_view value) {
+            const auto it = std::find(std::begin(names), std::end(names), name);
+            if (it == std::end(names)) {
+                return true;
+            }
+            const auto i = it - std::begin(names);
+            seen |= 1u << i;
+            return parse_number(value, values[i]) || error("Expected an unsigned integer");
+        };
+
+        bool empty;
+        if (!start_tag("tet") || !read_attributes(attribute, empty)) {
+            return false;
+        }
+        if (seen != 0x1f) {
+            return error("<tet> is missing an attribute");
+        }
+
+        Mesh4::Tet tet;
+        tet.cell = values[0];
+        std::copy(values + 1, values + 5, tet.vertices);
+        out.push_back(tet);
+        return finish_element("tet", empty);
+    }
+
+    // Read an `<indices>` element into a new vector at the end of `out`.
+    bool read_indices(std::vector<std::vector<u32>>& out) {
+        auto& indices = out.emplace_back();
+        return element_list("indices", indices, "<index", [&]() {
+            bool empty;
+            u32 value;
+            if (!start_element("index", empty)) {
+                return false;
+            }
+            if (empty) {
+                return error("Expected an unsigned integer");
+            }
+            if (!text_u32(value) || !end_tag("index")) {
+                return false;
+            }
+            indices.push_back(value);
+            return true;
+        });
+    }
+
+    bool read_mesh(Mesh4& out) {
+        if (starts_with("\xef\xbb\xbf")) {
+            pos_ += 3;
+        }
+
+        const auto attribute = [&](std::string_view name, std::string_view value) {
+            return name != "name" || decode_text(value, out.name) || error("Invalid character reference");
+        };
+
+        bool empty;
+        if (!start_tag("mesh4") || !read_attributes(attribute, empty)) {
+            return false;
+        }
+        if (empty) {
+            return error("Expected <vertices>");
+        }
+
+        if (!element_list("vertices", out.vertices, "<vec4", [&]() { return read_vec4(out.vertices); })
+            || !element_list("edges", out.edges, "<edge", [&]() { return read_edge(out.edges); })
+            || !element_list("faces", out.faces, "<indices", [&]() { return read_indices(out.faces); })
+            || !element_list("cells", out.cells, "<indices", [&]() { return read_indices(out.cells); })
+            || !element_list("tet_vertices", out.tet_vertices, "<vec4",
+                             [&]() { return read_vec4(out.tet_vertices); })
+            || !element_list("tets", out.tets, "<tet", [&]() { return read_tet(out.tets); }) || !end_tag("mesh4")
+            || !skip_misc()) {
+            return false;
+        }
+        if (!at_eof()) {
+            return error("Unexpected content after </mesh4>");
+        }
+        return true;
+    }
+};
+
+// Writes the `.mesh4` schema in the same layout as the files in
+// `data/meshes`.
+class MeshXmlWriter {
+private:
+    FileWriter& out_;
+
+public:
+    explicit MeshXmlWriter(FileWriter& out) : out_(out) {}
+
+    void escaped(std::string_view text) {
+        for (const char c : text) {
+            switch (c) {
+            case '<':
+                out_.put("&lt;");
+                break;
+            case '>':
+                out_.put("&gt;");
+                break;
+            case '&':
+                out_.put("&amp;");
+                break;
+            case '"':
+                out_.put("&quot;");
+                break;
+            default:
+                out_.put(c);
+                break;
+            }
+        }
+    }
+
+    template <class T>
+    void attribute(std::string_view name, const T value) {
+        out_.put(' ');
+        out_.put(name);
+        out_.put("=\"");
+        out_.put_number(value);
+        out_.put('"');
+    }
+
+    // Write `<name>`, the result of `fn(item)` for each of `items`, and
+    // `</name>`, or `<name/>` if there are no items.
+    template <class T, class Fn>
+    void element_list(std::string_view indent, std::string_view name, const std::vector<T>& items, Fn&& fn) {
+        out_.put(indent);
+        out_.put('<');
+        out_.put(name);
+        if (items.empty()) {
+            out_.put("/>\n");
+            return;
+        }
+        out_.put(">\n");
+        for (const auto& item : items) {
+            fn(item);
+        }
+        out_.put(indent);
+        out_.put("</");
+        out_.put(name);
+        out_.put(">\n");
+    }
+
+    void vec4(const glm::dvec4& v) {
+        out_.put("        <vec4");
+        attribute("x", v.x);
+        attribute("y", v.y);
+        attribute("z", v.z);
+        attribute("w", v.w);
+        out_.put("/>\n");
+    }
+
+    void indices(const std::vector<u32>& list) {
+        element_list("        ", "indices", list, [&](u32 index) {
+            out_.put("            <index>");
+            out_.put_number(index);
+            out_.put("</index>\n");
+        });
+    }
+
+    void mesh(const Mesh4& mesh) {
+        out_.put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<mesh4 name=\"");
+        escaped(mesh.name);
+        out_.put("\">\n");
+
+        element_list("    ", "vertices", mesh.vertices, [&](const glm::dvec4& v) { vec4(v); });
+        element_list("    ", "edges", mesh.edges, [&](const Edge& e) {
+            out_.put("        <edge");
+            attribute("v0", e.v0);
+            attribute("v1", e.v1);
+            out_.put("/>\n");
+        });
+        element_list("    ", "faces", mesh.faces, [&](const Face& f) { indices(f); });
+        element_list("    ", "cells", mesh.cells, [&](const Cell& c) { indices(c); });
+        element_list("    ", "tet_vertices", mesh.tet_vertices, [&](const glm::dvec4& v) { vec4(v); });
+        element_list("    ", "tets", mesh.tets, [&](const Mesh4::Tet& tet) {
+            out_.put("        <tet");
+            attribute("cell", tet.cell);
+            attribute("v0", tet.vertices[0]);
+            attribute("v1", tet.vertices[1]);
+            attribute("v2", tet.vertices[2]);
+            attribute("v3", tet.vertices[3]);
+            out_.put("/>\n");
+        });
+
+        out_.put("</mesh4>\n");
+    }
+};
+
+} // namespace
+
+bool parse_mesh_xml(const char* path, const char* data, const size_t size, Mesh4& out) {
+    out = {};
+    MeshXmlReader reader(path, data, data + size);
+    if (!reader.read_mesh(out)) {
+        return false;
+    }
+
+    if (!valid_indices(out)) {
+        LOG_F(ERROR, "%s has an index out of range", path);
+        return false;
+    }
+    return true;
+}
+
+bool write_mesh_xml(const Mesh4& mesh, const char* path) {
+    FileWriter file;
+    if (!file.open(path)) {
+        LOG_F(ERROR, "Could not open %s for writing", path);
+        return false;
+    }
+
+    MeshXmlWriter(file).mesh(mesh);
+
+    if (!file.close()) {
+        LOG_F(ERROR, "Could not write %s", path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace four
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+namespace four {
+
+// Parse the contents of an XML `.mesh4` file, `size` bytes at `data`, into
+// `out`. The parser knows the `.mesh4` schema and reads it in a single pass,
+// without building a document tree. Returns false and logs an error, with the
+// line number in the file at `path`, if the contents are malformed or an index
+// is out of range.
+bool parse_mesh_xml(const char* path, const char* data, size_t size, Mesh4& out);
+
+// Write `mesh` to `path` as an XML `.mesh4` file. The file is written as it
+// is generated, through a fixed-size buffer, so memory use does not grow with
+// the size of the mesh. Returns false and logs an error if the file cannot be
+// written.
+bool write_mesh_xml(const Mesh4& mesh, const char* path);
+
+} // namespace four
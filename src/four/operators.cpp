@@ -0,0 +1,650 @@
+#include <four/operators.hpp>
+
+#include <four/parallel.hpp>
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace four {
+
+namespace {
+
+constexpr u32 no_index = UINT32_MAX;
+constexpr f64 pi = 3.14159265358979323846;
+
+// Distances are compared relative to the circumradius. This is looser than the
+// tolerance `convex_hull` merges coplanar facets with, so its cells are flat.
+constexpr f64 epsilon = 0.00000001;
+
+// The hyperplane of a cell, as its unit normal pointing away from the centre
+// of the mesh and its distance from the centre.
+struct CellPlane {
+    glm::dvec4 normal;
+    f64 distance;
+    glm::dvec4 centroid;
+};
+
+bool cancelled(const GenerateProgress* progress) {
+    return progress && progress->cancelled();
+}
+
+// The centroid of a mesh's vertices and their greatest distance from it.
+struct Bounds {
+    glm::dvec4 centre;
+    f64 radius;
+};
+
+Bounds bounds(const std::vector<glm::dvec4>& vertices) {
+    Bounds b = {glm::dvec4(0, 0, 0, 0), 0.0};
+    for (const auto& v : vertices) {
+        b.centre += v;
+    }
+    b.centre /= (f64)vertices.size();
+
+    for (const auto& v : vertices) {
+        b.radius = std::max(b.radius, glm::length(v - b.centre));
+    }
+    return b;
+}
+
+// The distinct vertices of `cell`, sorted.
+void cell_vertices(const Mesh4& mesh, const Cell& cell, std::vector<u32>& out) {
+    out.clear();
+    for (u32 f_i : cell) {
+        for (u32 e_i : mesh.faces[f_i]) {
+            const Edge& e = mesh.edges[e_i];
+            out.push_back(e.v0);
+            out.push_back(e.v1);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Fit a hyperplane to the vertices of a cell. Three directions spanning the
+// cell are picked greedily, each the vertex furthest from the span of those
+// before, which keeps the normal accurate for thin cells. Returns false if the
+// vertices do not span a hyperplane or do not all lie in it.
+bool fit_cell_plane(const Mesh4& mesh, const std::vector<u32>& vertices, const glm::dvec4& centre,
+                    const f64 tolerance, CellPlane& out) {
+    const glm::dvec4 origin = mesh.vertices[vertices[0]];
+
+    glm::dvec4 basis[3];
+    glm::dvec4 directions[3];
+    for (s32 i = 0; i < 3; i++) {
+        f64 best_length = 0.0;
+        for (u32 v_i : vertices) {
+            glm::dvec4 d = mesh.vertices[v_i] - origin;
+            for (s32 j = 0; j < i; j++) {
+                d -= glm::dot(d, basis[j]) * basis[j];
+            }
+            const f64 length = glm::length(d);
+            if (length > best_length) {
+                best_length = length;
+                basis[i] = d / length;
+                directions[i] = mesh.vertices[v_i] - origin;
+            }
+        }
+        if (best_length <= tolerance) {
+            return false;
+        }
+    }
+
+    out.normal = glm::normalize(cross(directions[0], directions[1], directions[2]));
+    out.centroid = glm::dvec4(0, 0, 0, 0);
+    for (u32 v_i : vertices) {
+        const glm::dvec4& v = mesh.vertices[v_i];
+        if (std::abs(glm::dot(out.normal, v - origin)) > tolerance) {
+            return false;
+        }
+        out.centroid += v;
+    }
+    out.centroid /= (f64)vertices.size();
+
+    out.distance = glm::dot(out.normal, out.centroid - centre);
+    if (out.distance < 0.0) {
+        out.normal = -out.normal;
+        out.distance = -out.distance;
+    }
+    return true;
+}
+
+// Fit the hyperplane of every cell of `mesh`. Returns false if a cell is not
+// flat.
+bool fit_cell_planes(const Mesh4& mesh, const Bounds& b, std::vector<CellPlane>& out) {
+    const f64 tolerance = epsilon * b.radius;
+    out.resize(mesh.cells.size());
+
+    std::atomic<bool> flat = true;
+    parallel_for("cells", (u32)mesh.cells.size(), hardware_threads(), [&](u32 c, u32) {
+        std::vector<u32> vertices;
+        cell_vertices(mesh, mesh.cells[c], vertices);
+        if (!fit_cell_plane(mesh, vertices, b.centre, tolerance, out[c])) {
+            flat = false;
+        }
+    });
+
+    return flat;
+}
+
+// Find the two cells on either side of each face, as `out[2 * f]` and
+// `out[2 * f + 1]`. Returns false and logs an error if the cells do not form a
+// closed hypersurface.
+bool find_face_cells(const Mesh4& mesh, const char* what, std::vector<u32>& out) {
+    const u32 n_faces = (u32)mesh.faces.size();
+    if (mesh.vertices.size() < 5 || mesh.cells.size() < 5) {
+        LOG_F(ERROR, "Cannot %s %s: it is not a 4-polytope", what, mesh.name.c_str());
+        return false;
+    }
+
+    out.assign((size_t)n_faces * 2, no_index);
+    for (u32 c = 0; c < mesh.cells.size(); c++) {
+        for (u32 f : mesh.cells[c]) {
+            u32* sides = &out[(size_t)f * 2];
+            if (sides[1] != no_index) {
+                LOG_F(ERROR, "Cannot %s %s: face %u is in more than two cells", what, mesh.name.c_str(), f);
+                return false;
+            }
+            sides[sides[0] == no_index ? 0 : 1] = c;
+        }
+    }
+    for (u32 f = 0; f < n_faces; f++) {
+        if (out[(size_t)f * 2 + 1] == no_index) {
+            LOG_F(ERROR, "Cannot %s %s: face %u is not shared by two cells", what, mesh.name.c_str(), f);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check that `mesh` is the boundary of a convex polytope around the centroid
+// `b.centre` of its vertices, and find the cells on either side of each face,
+// as `find_face_cells` does, and the hyperplane of each cell. Returns false
+// and logs an error if it is not.
+bool check_convex(const Mesh4& mesh, const char* what, const Bounds& b, std::vector<u32>& face_cells,
+                  std::vector<CellPlane>& planes) {
+    if (!find_face_cells(mesh, what, face_cells)) {
+        return false;
+    }
+
+    if (!fit_cell_planes(mesh, b, planes)) {
+        LOG_F(ERROR, "Cannot %s %s: not every cell is flat", what, mesh.name.c_str());
+        return false;
+    }
+
+    // A closed hypersurface that is convex along every ridge bounds a convex
+    // polytope, so checking the neighbours across each face is enough: each
+    // must lie strictly behind the other's hyperplane. This also rules out
+    // neighbouring cells in the same hyperplane, whose poles would coincide.
+    const f64 tolerance = epsilon * b.radius;
+    for (u32 f = 0; f < (u32)mesh.faces.size(); f++) {
+        const CellPlane& p = planes[face_cells[(size_t)f * 2]];
+        const CellPlane& q = planes[face_cells[(size_t)f * 2 + 1]];
+        if (p.distance <= tolerance || glm::dot(p.normal, q.centroid - b.centre) >= p.distance - tolerance
+            || glm::dot(q.normal, p.centroid - b.centre) >= q.distance - tolerance) {
+            LOG_F(ERROR, "Cannot %s %s: it is not convex around its centroid", what, mesh.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// The incidences between the elements of a mesh that truncation-like operators
+// are built from, found in one pass over each of the faces and cells.
+//
+// A corner is a vertex of a face with the two edges of the face that meet at
+// it. A face has as many corners as edges, so the corners of face `f` and the
+// slots of its edges share the indices [face_offsets[f], face_offsets[f + 1]):
+// the edge in slot `face_offsets[f] + i` is `mesh.faces[f][i]`, and the corners
+// are sorted by vertex. Likewise the distinct vertices of cell `c`, sorted, are
+// `cell_vertices[cell_offsets[c]...]`, and their indices there number the
+// vertex-cell pairs of the mesh.
+struct Incidences {
+    struct Corner {
+        u32 vertex;
+        u32 edges[2];
+    };
+
+    std::vector<u32> face_cells;
+    std::vector<u32> face_offsets;
+    std::vector<Corner> corners;
+    std::vector<u32> cell_offsets;
+    std::vector<u32> cell_vertices;
+
+    // Returns false and logs an error if `mesh` is not a closed hypersurface
+    // of polygonal faces.
+    bool build(const Mesh4& mesh, const char* what) {
+        if (!find_face_cells(mesh, what, face_cells)) {
+            return false;
+        }
+
+        const u32 n_faces = (u32)mesh.faces.size();
+        face_offsets.resize((size_t)n_faces + 1);
+        face_offsets[0] = 0;
+        for (u32 f = 0; f < n_faces; f++) {
+            face_offsets[f + 1] = face_offsets[f] + (u32)mesh.faces[f].size();
+        }
+
+        // Each vertex of a polygon is an end of exactly two of its edges.
+        corners.resize(face_offsets[n_faces]);
+        std::vector<std::pair<u32, u32>> ends;
+        for (u32 f = 0; f < n_faces; f++) {
+            ends.clear();
+            for (u32 e : mesh.faces[f]) {
+                ends.emplace_back(mesh.edges[e].v0, e);
+                ends.emplace_back(mesh.edges[e].v1, e);
+            }
+            std::sort(ends.begin(), ends.end());
+
+            for (size_t i = 0; i < ends.size(); i += 2) {
+                if (ends[i].first != ends[i + 1].first || (i + 2 < ends.size() && ends[i + 2].first == ends[i].first)) {
+                    LOG_F(ERROR, "Cannot %s %s: face %u is not a polygon", what, mesh.name.c_str(), f);
+                    return false;
+                }
+                corners[face_offsets[f] + i / 2] = {ends[i].first, {ends[i].second, ends[i + 1].second}};
+            }
+        }
+
+        const u32 n_cells = (u32)mesh.cells.size();
+        cell_offsets.resize((size_t)n_cells + 1);
+        cell_offsets[0] = 0;
+        cell_vertices.clear();
+        std::vector<u32> vertices;
+        for (u32 c = 0; c < n_cells; c++) {
+            four::cell_vertices(mesh, mesh.cells[c], vertices);
+            cell_vertices.insert(cell_vertices.end(), vertices.begin(), vertices.end());
+            cell_offsets[c + 1] = (u32)cell_vertices.size();
+        }
+
+        return true;
+    }
+
+    // The index of the pair of vertex `v` and cell `c`.
+    u32 vertex_cell(const u32 v, const u32 c) const {
+        const auto begin = cell_vertices.begin() + cell_offsets[c];
+        const auto end = cell_vertices.begin() + cell_offsets[c + 1];
+        const auto it = std::lower_bound(begin, end, v);
+        DCHECK_F(it != end && *it == v);
+        return (u32)(it - cell_vertices.begin());
+    }
+
+    // The slot of edge `e` in face `f`.
+    u32 edge_slot(const Mesh4& mesh, const u32 e, const u32 f) const {
+        const Face& face = mesh.faces[f];
+        const auto it = std::find(face.begin(), face.end(), e);
+        DCHECK_F(it != face.end());
+        return face_offsets[f] + (u32)(it - face.begin());
+    }
+
+    glm::dvec4 face_centroid(const Mesh4& mesh, const u32 f) const {
+        glm::dvec4 centroid(0, 0, 0, 0);
+        for (u32 i = face_offsets[f]; i < face_offsets[f + 1]; i++) {
+            centroid += mesh.vertices[corners[i].vertex];
+        }
+        return centroid / (f64)(face_offsets[f + 1] - face_offsets[f]);
+    }
+};
+
+// Build the topology shared by truncation and rectification, whose new
+// vertices lie on the edges of the mesh: `edge_vertex(e, v)` is the new vertex
+// on edge `e` nearest vertex `v`. Each corner of a face becomes an edge, each
+// face a face with those edges as well as any new edge on each old edge
+// (`edge_edges`), and each vertex of each cell a face cutting off the vertex.
+// The cells are the cut-down old cells and the cuts around each old vertex.
+template <class EdgeVertex>
+void build_vertex_cuts(const Mesh4& mesh, const Incidences& in, const bool edge_edges, EdgeVertex&& edge_vertex,
+                       Mesh4& out) {
+    const u32 n_edges = (u32)mesh.edges.size();
+    const u32 n_corners = (u32)in.corners.size();
+
+    // Edges: the old edges, if kept, then one per corner.
+    const u32 corner_edges = edge_edges ? n_edges : 0;
+    out.edges.clear();
+    out.edges.reserve((size_t)corner_edges + n_corners);
+    if (edge_edges) {
+        for (u32 e = 0; e < n_edges; e++) {
+            out.edges.emplace_back(edge_vertex(e, mesh.edges[e].v0), edge_vertex(e, mesh.edges[e].v1));
+        }
+    }
+    for (const auto& corner : in.corners) {
+        out.edges.emplace_back(edge_vertex(corner.edges[0], corner.vertex),
+                               edge_vertex(corner.edges[1], corner.vertex));
+    }
+
+    // Faces: one per old face, then one per vertex-cell pair.
+    const u32 n_faces = (u32)mesh.faces.size();
+    out.faces.clear();
+    out.faces.resize((size_t)n_faces + in.cell_vertices.size());
+    for (u32 f = 0; f < n_faces; f++) {
+        Face& face = out.faces[f];
+        if (edge_edges) {
+            face = mesh.faces[f];
+        }
+        for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+            face.push_back(corner_edges + i);
+        }
+    }
+    for (u32 c = 0; c < mesh.cells.size(); c++) {
+        for (u32 f : mesh.cells[c]) {
+            for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+                out.faces[n_faces + in.vertex_cell(in.corners[i].vertex, c)].push_back(corner_edges + i);
+            }
+        }
+    }
+
+    // Cells: one per old cell, then one per old vertex.
+    const u32 n_cells = (u32)mesh.cells.size();
+    out.cells.clear();
+    out.cells.resize((size_t)n_cells + mesh.vertices.size());
+    for (u32 c = 0; c < n_cells; c++) {
+        Cell& cell = out.cells[c];
+        cell = mesh.cells[c];
+        for (u32 i = in.cell_offsets[c]; i < in.cell_offsets[c + 1]; i++) {
+            cell.push_back(n_faces + i);
+            out.cells[(size_t)n_cells + in.cell_vertices[i]].push_back(n_faces + i);
+        }
+    }
+}
+
+// Check that the cells of a newly built mesh are flat, and log it.
+bool finish(Mesh4& mesh, const char* what, const std::string& input_name) {
+    std::vector<CellPlane> planes;
+    if (!fit_cell_planes(mesh, bounds(mesh.vertices), planes)) {
+        LOG_F(ERROR, "Cannot %s %s: not every new cell would be flat", what, input_name.c_str());
+        return false;
+    }
+
+    LOG_F(INFO, "Generated %s with %lu vertices, %lu edges, %lu faces and %lu cells", mesh.name.c_str(),
+          mesh.vertices.size(), mesh.edges.size(), mesh.faces.size(), mesh.cells.size());
+    return true;
+}
+} // namespace
+
+bool dual(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress) {
+    const char* what = "take the dual of";
+    const u32 n_vertices = (u32)mesh.vertices.size();
+    const u32 n_edges = (u32)mesh.edges.size();
+    const u32 n_faces = (u32)mesh.faces.size();
+    const u32 n_cells = (u32)mesh.cells.size();
+
+    const Bounds b = bounds(mesh.vertices);
+    std::vector<u32> face_cells;
+    std::vector<CellPlane> planes;
+    if (!check_convex(mesh, what, b, face_cells, planes) || cancelled(progress)) {
+        return false;
+    }
+
+    Mesh4 result;
+    result.name = "dual-" + mesh.name;
+
+    result.vertices.resize(n_cells);
+    f64 dual_radius = 0.0;
+    for (u32 c = 0; c < n_cells; c++) {
+        result.vertices[c] = planes[c].normal / planes[c].distance;
+        dual_radius = std::max(dual_radius, 1.0 / planes[c].distance);
+    }
+    for (auto& v : result.vertices) {
+        v = b.centre + v * (b.radius / dual_radius);
+    }
+
+    result.edges.resize(n_faces);
+    for (u32 f = 0; f < n_faces; f++) {
+        result.edges[f] = Edge(face_cells[(size_t)f * 2], face_cells[(size_t)f * 2 + 1]);
+    }
+
+    // The faces around each edge, and the edges around each vertex, in order
+    // of index.
+    result.faces.resize(n_edges);
+    for (u32 f = 0; f < n_faces; f++) {
+        for (u32 e : mesh.faces[f]) {
+            result.faces[e].push_back(f);
+        }
+    }
+    if (cancelled(progress)) {
+        return false;
+    }
+
+    result.cells.resize(n_vertices);
+    for (u32 e = 0; e < n_edges; e++) {
+        result.cells[mesh.edges[e].v0].push_back(e);
+        result.cells[mesh.edges[e].v1].push_back(e);
+    }
+
+    for (const Face& face : result.faces) {
+        if (face.size() < 3) {
+            LOG_F(ERROR, "Cannot %s %s: an edge is in fewer than three faces", what, mesh.name.c_str());
+            return false;
+        }
+    }
+    for (const Cell& cell : result.cells) {
+        if (cell.size() < 4) {
+            LOG_F(ERROR, "Cannot %s %s: a vertex is in fewer than four edges", what, mesh.name.c_str());
+            return false;
+        }
+    }
+
+    LOG_F(INFO, "Generated %s with %lu vertices, %lu edges, %lu faces and %lu cells", result.name.c_str(),
+          result.vertices.size(), result.edges.size(), result.faces.size(), result.cells.size());
+
+    out = std::move(result);
+    return true;
+}
+
+bool is_convex(const Mesh4& mesh, const char* what) {
+    std::vector<u32> face_cells;
+    std::vector<CellPlane> planes;
+    return check_convex(mesh, what, bounds(mesh.vertices), face_cells, planes);
+}
+
+bool truncate(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress) {
+    const char* what = "truncate";
+    Incidences in;
+    if (!in.build(mesh, what) || cancelled(progress)) {
+        return false;
+    }
+
+    // Cutting a fraction t = 1 / (2 + 2 cos(π/p)) off each end of the edges
+    // of a regular p-gon leaves a regular 2p-gon.
+    size_t p = mesh.faces[0].size();
+    for (const Face& face : mesh.faces) {
+        if (face.size() != p) {
+            p = 0;
+            break;
+        }
+    }
+    const f64 t = p == 0 ? 1.0 / 3.0 : 1.0 / (2.0 + 2.0 * cos(pi / (f64)p));
+
+    Mesh4 result;
+    result.name = "truncated-" + mesh.name;
+
+    // The new vertices on edge `e` are 2e, nearest `e.v0`, and 2e + 1.
+    result.vertices.resize(mesh.edges.size() * 2);
+    for (u32 e = 0; e < mesh.edges.size(); e++) {
+        const glm::dvec4& v0 = mesh.vertices[mesh.edges[e].v0];
+        const glm::dvec4& v1 = mesh.vertices[mesh.edges[e].v1];
+        result.vertices[(size_t)e * 2] = v0 + t * (v1 - v0);
+        result.vertices[(size_t)e * 2 + 1] = v1 + t * (v0 - v1);
+    }
+
+    build_vertex_cuts(mesh, in, true, [&](u32 e, u32 v) { return e * 2 + (v == mesh.edges[e].v0 ? 0 : 1); }, result);
+
+    if (cancelled(progress) || !finish(result, what, mesh.name)) {
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+bool rectify(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress) {
+    const char* what = "rectify";
+    Incidences in;
+    if (!in.build(mesh, what) || cancelled(progress)) {
+        return false;
+    }
+
+    Mesh4 result;
+    result.name = "rectified-" + mesh.name;
+
+    result.vertices.resize(mesh.edges.size());
+    for (u32 e = 0; e < mesh.edges.size(); e++) {
+        result.vertices[e] = (mesh.vertices[mesh.edges[e].v0] + mesh.vertices[mesh.edges[e].v1]) / 2.0;
+    }
+
+    build_vertex_cuts(mesh, in, false, [](u32 e, u32) { return e; }, result);
+
+    if (cancelled(progress) || !finish(result, what, mesh.name)) {
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+bool bitruncate(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress) {
+    const char* what = "bitruncate";
+    Incidences in;
+    if (!in.build(mesh, what) || cancelled(progress)) {
+        return false;
+    }
+
+    const u32 n_edges = (u32)mesh.edges.size();
+    const u32 n_faces = (u32)mesh.faces.size();
+    const u32 n_cells = (u32)mesh.cells.size();
+    const u32 n_slots = (u32)in.corners.size();
+    const u32 n_vertex_cells = (u32)in.cell_vertices.size();
+    const Bounds b = bounds(mesh.vertices);
+
+    std::vector<glm::dvec4> cell_centroids(n_cells, glm::dvec4(0, 0, 0, 0));
+    for (u32 c = 0; c < n_cells; c++) {
+        for (u32 i = in.cell_offsets[c]; i < in.cell_offsets[c + 1]; i++) {
+            cell_centroids[c] += mesh.vertices[in.cell_vertices[i]];
+        }
+        cell_centroids[c] /= (f64)(in.cell_offsets[c + 1] - in.cell_offsets[c]);
+    }
+
+    Mesh4 result;
+    result.name = "bitruncated-" + mesh.name;
+
+    // One vertex per edge slot of each face, between the middle of the edge
+    // and the centre of the face. For a regular polytope, the point that makes
+    // the result uniform is the one equally far from two mirrors of the
+    // symmetry group: the one through the face's centre that swaps the ends
+    // of the edge's neighbour in the face, and the one through the edge that
+    // swaps the face with its neighbour in a cell. Each is a hyperplane
+    // through the centre of the mesh, and for other polytopes the distances
+    // to them are averaged over the two cells of the face.
+    result.vertices.resize(n_slots);
+    for (u32 f = 0; f < n_faces; f++) {
+        const glm::dvec4 face_centre = in.face_centroid(mesh, f) - b.centre;
+        for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+            const Edge& e = mesh.edges[mesh.faces[f][i - in.face_offsets[f]]];
+            const glm::dvec4 v0 = mesh.vertices[e.v0] - b.centre;
+            const glm::dvec4 v1 = mesh.vertices[e.v1] - b.centre;
+            const glm::dvec4 edge_centre = (v0 + v1) / 2.0;
+
+            f64 edge_distance = 0.0;
+            f64 face_distance = 0.0;
+            for (s32 side = 0; side < 2; side++) {
+                const glm::dvec4 cell_centre = cell_centroids[in.face_cells[(size_t)f * 2 + (size_t)side]] - b.centre;
+                const glm::dvec4 face_mirror = glm::normalize(cross(v0, face_centre, cell_centre));
+                const glm::dvec4 edge_mirror = glm::normalize(cross(v0, v1, cell_centre));
+                edge_distance += std::abs(glm::dot(face_mirror, edge_centre));
+                face_distance += std::abs(glm::dot(edge_mirror, face_centre));
+            }
+
+            result.vertices[i] = b.centre
+                                 + (face_distance * edge_centre + edge_distance * face_centre)
+                                           / (edge_distance + face_distance);
+        }
+    }
+
+    if (cancelled(progress)) {
+        return false;
+    }
+
+    // Edges: one per corner of each face, joining the vertices of its two
+    // edges in the face, then one per edge of each cell, joining the vertices
+    // of the edge in the cell's two faces around it. The second kind are
+    // found a cell at a time by sorting the cell's edge slots by edge.
+    result.edges.reserve((size_t)n_slots * 2);
+    for (u32 f = 0; f < n_faces; f++) {
+        for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+            const auto& corner = in.corners[i];
+            result.edges.emplace_back(in.edge_slot(mesh, corner.edges[0], f), in.edge_slot(mesh, corner.edges[1], f));
+        }
+    }
+
+    // Faces: one per old face, then one per vertex-cell pair, then one per
+    // old edge.
+    const u32 vertex_cell_faces = n_faces;
+    const u32 edge_faces = vertex_cell_faces + n_vertex_cells;
+    result.faces.resize((size_t)edge_faces + n_edges);
+
+    std::vector<std::pair<u32, u32>> cell_slots;
+    for (u32 c = 0; c < n_cells; c++) {
+        if (c % 1024 == 0 && cancelled(progress)) {
+            return false;
+        }
+        cell_slots.clear();
+        for (u32 f : mesh.cells[c]) {
+            for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+                cell_slots.emplace_back(mesh.faces[f][i - in.face_offsets[f]], i);
+
+                // The corner's edge is in the face of this vertex and cell.
+                result.faces[vertex_cell_faces + in.vertex_cell(in.corners[i].vertex, c)].push_back(i);
+            }
+        }
+        std::sort(cell_slots.begin(), cell_slots.end());
+
+        for (size_t i = 0; i < cell_slots.size(); i += 2) {
+            const u32 e = cell_slots[i].first;
+            if (i + 1 >= cell_slots.size() || cell_slots[i + 1].first != e
+                || (i + 2 < cell_slots.size() && cell_slots[i + 2].first == e)) {
+                LOG_F(ERROR, "Cannot %s %s: cell %u is not closed", what, mesh.name.c_str(), c);
+                return false;
+            }
+
+            const u32 edge = (u32)result.edges.size();
+            result.edges.emplace_back(cell_slots[i].second, cell_slots[i + 1].second);
+            result.faces[edge_faces + e].push_back(edge);
+            result.faces[vertex_cell_faces + in.vertex_cell(mesh.edges[e].v0, c)].push_back(edge);
+            result.faces[vertex_cell_faces + in.vertex_cell(mesh.edges[e].v1, c)].push_back(edge);
+        }
+    }
+
+    for (u32 f = 0; f < n_faces; f++) {
+        for (u32 i = in.face_offsets[f]; i < in.face_offsets[f + 1]; i++) {
+            result.faces[f].push_back(i);
+        }
+    }
+
+    // Cells: one per old cell, then one per old vertex.
+    result.cells.resize((size_t)n_cells + mesh.vertices.size());
+    for (u32 c = 0; c < n_cells; c++) {
+        Cell& cell = result.cells[c];
+        cell = mesh.cells[c];
+        for (u32 i = in.cell_offsets[c]; i < in.cell_offsets[c + 1]; i++) {
+            cell.push_back(vertex_cell_faces + i);
+            result.cells[(size_t)n_cells + in.cell_vertices[i]].push_back(vertex_cell_faces + i);
+        }
+    }
+    for (u32 e = 0; e < n_edges; e++) {
+        result.cells[(size_t)n_cells + mesh.edges[e].v0].push_back(edge_faces + e);
+        result.cells[(size_t)n_cells + mesh.edges[e].v1].push_back(edge_faces + e);
+    }
+
+    if (cancelled(progress) || !finish(result, what, mesh.name)) {
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+} // namespace four
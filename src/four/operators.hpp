@@ -0,0 +1,50 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+namespace four {
+
+// Operations that build a new 4-polytope from an existing one. They work on the
+// topology of the input directly, so unlike the generators they need no
+// search, and their cost is linear in the size of the mesh. The result has no
+// tetrahedralization; pass it to `tetrahedralize` before rendering. If
+// `progress` is given and is cancelled, they return false without logging an
+// error.
+
+// The dual of the convex polytope `mesh`: each cell becomes a vertex, each face
+// shared by two cells an edge between their vertices, each edge a face and each
+// vertex a cell. The vertex of a cell is the pole of its hyperplane with
+// respect to a sphere about the centroid of the mesh's vertices, which makes
+// the new cells flat; for a regular polytope it is the cell's centroid, scaled
+// out from the centre. The result has the same circumradius as `mesh`.
+// Returns false and logs an error if `mesh` is not the boundary of a convex
+// polytope around its centroid.
+bool dual(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress = NULL);
+
+// Whether `mesh` is the boundary of a convex polytope around the centroid of
+// its vertices, as `dual` needs. If not, logs an error saying that it cannot
+// `what` the mesh.
+bool is_convex(const Mesh4& mesh, const char* what);
+
+// Truncation operators, which cut every vertex of `mesh` off with a hyperplane
+// and keep the cut-down cells, the new cells left by the cuts, and their
+// faces. They need each vertex's cut to be flat, which holds for any polytope
+// whose vertices are all alike (uniform polytopes, for example), and for
+// those give uniform results if `mesh` is regular. Each returns false and logs
+// an error if `mesh` is not a closed 4-polytope or the cuts are not flat.
+
+// Cut each edge a fraction 1 / (2 + 2 cos(π/p)) of its length from each end,
+// which turns regular p-gon faces into regular 2p-gons. If the faces have
+// different numbers of sides, a third is cut from each end instead.
+bool truncate(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress = NULL);
+
+// Cut through the middle of each edge.
+bool rectify(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress = NULL);
+
+// Cut past the middle of each edge, so deep that the cuts around each cell
+// truncate one another and each face shrinks to a polygon with a vertex
+// between the middle of each of its edges and its centre. The result has the
+// same combinatorial structure for a polytope and its dual.
+bool bitruncate(const Mesh4& mesh, Mesh4& out, const GenerateProgress* progress = NULL);
+
+} // namespace four
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace four {
+
+// The number of worker threads to use for parallel work.
+inline u32 hardware_threads() {
+    const u32 n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// The number of threads that `parallel_for` may start in addition to the
+// threads calling it. Every `parallel_for` running at the same time, including
+// nested ones, draws from this one budget, so that together they never run
+// more threads than `hardware_threads()`.
+inline std::atomic<s32>& spare_threads() {
+    static std::atomic<s32> n = (s32)hardware_threads() - 1;
+    return n;
+}
+
+// Take up to `n` threads from the budget. Returns the number taken, which
+// must be given back with `release_threads`.
+inline u32 acquire_threads(const u32 n) {
+    auto& spare = spare_threads();
+    s32 available = spare.load(std::memory_order_relaxed);
+    while (true) {
+        const s32 take = std::min((s32)n, std::max(available, 0));
+        if (take == 0) {
+            return 0;
+        }
+        if (spare.compare_exchange_weak(available, available - take, std::memory_order_acq_rel)) {
+            return (u32)take;
+        }
+    }
+}
+
+inline void release_threads(const u32 n) {
+    spare_threads().fetch_add((s32)n, std::memory_order_release);
+}
+
+// Call `fn(i, worker)` for each `i` in [0, n), spread across `n_workers`
+// threads. `worker` is in [0, n_workers) and can be used to index per-thread
+// state. Blocks until every call has returned. Fewer than `n_workers` threads
+// are used if the thread budget (see `spare_threads`) is short.
+//
+// The range is split evenly between the workers up front. A worker that runs
+// out of indices steals the back half of the largest range left to another
+// worker, so uneven per-index costs do not leave threads idle.
+template <class Fn>
+void parallel_for(const char* name, const u32 n, u32 n_workers, Fn&& fn) {
+    if (n_workers > n) {
+        n_workers = n;
+    }
+    if (n_workers > 1) {
+        n_workers = 1 + acquire_threads(n_workers - 1);
+    }
+    if (n_workers <= 1) {
+        for (u32 i = 0; i < n; i++) {
+            fn(i, 0u);
+        }
+        return;
+    }
+
+    // Each worker's remaining range [begin, end), packed as `begin | end << 32`
+    // so that it can be updated with a single compare-and-swap.
+    struct alignas(64) Range {
+        std::atomic<u64> value;
+    };
+
+    const auto pack = [](u32 begin, u32 end) -> u64 { return (u64)begin | (u64)end << 32; };
+    const auto begin_of = [](u64 range) -> u32 { return (u32)range; };
+    const auto end_of = [](u64 range) -> u32 { return (u32)(range >> 32); };
+
+    std::vector<Range> ranges(n_workers);
+    for (u32 w = 0; w < n_workers; w++) {
+        const u32 begin = (u32)((u64)n * w / n_workers);
+        const u32 end = (u32)((u64)n * (w + 1) / n_workers);
+        ranges[w].value.store(pack(begin, end), std::memory_order_relaxed);
+    }
+
+    const auto run_worker = [&](u32 w) {
+        auto& own = ranges[w].value;
+
+        while (true) {
+            // Take indices from the front of our own range.
+            u64 range = own.load(std::memory_order_acquire);
+            while (begin_of(range) < end_of(range)) {
+                if (own.compare_exchange_weak(range, pack(begin_of(range) + 1, end_of(range)),
+                                              std::memory_order_acq_rel)) {
+                    fn(begin_of(range), w);
+                    range = own.load(std::memory_order_acquire);
+                }
+            }
+
+            // Steal the back half of the largest remaining range.
+            bool stole = false;
+            while (!stole) {
+                u32 victim = w;
+                u32 victim_size = 0;
+                u64 victim_range = 0;
+                for (u32 other = 0; other < n_workers; other++) {
+                    const u64 r = ranges[other].value.load(std::memory_order_acquire);
+                    if (other != w && end_of(r) > begin_of(r) && end_of(r) - begin_of(r) > victim_size) {
+                        victim = other;
+                        victim_size = end_of(r) - begin_of(r);
+                        victim_range = r;
+                    }
+                }
+
+                if (victim == w) {
+                    return;
+                }
+
+                const u32 begin = begin_of(victim_range);
+                const u32 end = end_of(victim_range);
+                const u32 mid = begin + (end - begin) / 2;
+                if (ranges[victim].value.compare_exchange_strong(victim_range, pack(begin, mid),
+                                                                 std::memory_order_acq_rel)) {
+                    own.store(pack(mid, end), std::memory_order_release);
+                    stole = true;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_workers - 1);
+    for (u32 w = 1; w < n_workers; w++) {
+        threads.emplace_back([&, w]() {
+            loguru::set_thread_name(loguru::textprintf("%s%u", name, w).c_str());
+            run_worker(w);
+
+            // Give the thread back as soon as it runs out of work, so that
+            // other `parallel_for`s can use it.
+            release_threads(1);
+        });
+    }
+
+    run_worker(0);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// A hash set that can be inserted into from many threads at once. Elements are
+// spread across independently locked shards by hash, so threads rarely contend
+// for the same lock. `Hash` and `Equals` must be safe to call concurrently.
+template <class T, class Hash = std::hash<T>, class Equals = std::equal_to<T>>
+class ShardedSet {
+private:
+    static constexpr size_t n_shards = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_set<T, Hash, Equals> set;
+    };
+
+    Hash hash_;
+    std::vector<Shard> shards_;
+
+    Shard& shard_for(const T& value) {
+        size_t hash = hash_(value);
+        hash ^= hash >> 29;
+        return shards_[hash % n_shards];
+    }
+
+public:
+    ShardedSet() : shards_(n_shards) {}
+
+    // Returns true if `value` was not already in the set.
+    bool insert(T value) {
+        Shard& shard = shard_for(value);
+        auto lock = std::scoped_lock(shard.mutex);
+        return shard.set.insert(std::move(value)).second;
+    }
+
+    // Move every element out of the set. Must not be called concurrently with
+    // `insert`.
+    std::vector<T> take() {
+        std::vector<T> result;
+        for (auto& shard : shards_) {
+            for (auto it = shard.set.begin(); it != shard.set.end();) {
+                auto node = shard.set.extract(it++);
+                result.push_back(std::move(node.value()));
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace four
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <four/math.hpp>
+#include <four/utility.hpp>
+
+#include <math.h>
+
+#include <array>
+#include <unordered_map>
+
+namespace four {
+
+// Looks up points by position. Positions are quantized to a fine grid; a
+// lookup also probes the neighbouring grid points of any coordinate that lies
+// close to a rounding boundary, so that two computations of the same point
+// that differ by floating point error are always found.
+struct PointIndex4 {
+    static constexpr f64 scale = 1073741824.0; // 2^30
+    static constexpr f64 boundary = 0.45;
+
+    using Key = std::array<s64, 4>;
+
+    struct KeyHash {
+        size_t operator()(const Key& x) const {
+            size_t hash = 0;
+            for (s64 c : x) {
+                hash_combine(hash, c);
+            }
+            return hash;
+        }
+    };
+
+    std::unordered_map<Key, u32, KeyHash> map;
+
+    static Key key(const glm::dvec4& p) {
+        Key result;
+        for (s32 i = 0; i < 4; i++) {
+            result[(size_t)i] = llround(p[i] * scale);
+        }
+        return result;
+    }
+
+    bool find(const glm::dvec4& p, u32& out) const {
+        Key base = key(p);
+        s64 alt[4];
+        for (s32 i = 0; i < 4; i++) {
+            f64 diff = p[i] * scale - (f64)base[(size_t)i];
+            alt[i] = std::abs(diff) > boundary ? (diff > 0 ? 1 : -1) : 0;
+        }
+
+        for (u32 mask = 0; mask < 16; mask++) {
+            Key k = base;
+            bool skip = false;
+            for (s32 i = 0; i < 4; i++) {
+                if (mask & (1u << i)) {
+                    if (alt[i] == 0) {
+                        skip = true;
+                        break;
+                    }
+                    k[(size_t)i] += alt[i];
+                }
+            }
+
+            if (!skip) {
+                auto it = map.find(k);
+                if (it != map.cend()) {
+                    out = it->second;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void insert(const glm::dvec4& p, u32 index) {
+        map.emplace(key(p), index);
+    }
+};
+
+} // namespace four
@@ -0,0 +1,277 @@
+#include <four/prism.hpp>
+
+#include <four/utility.hpp>
+#include <four/wythoff.hpp>
+
+#include <loguru.hpp>
+
+#include <math.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace four {
+
+namespace {
+
+constexpr f64 circumradius = 2.0;
+constexpr f64 pi = 3.14159265358979323846;
+
+void scale_to_circumradius(Mesh4& mesh) {
+    f64 max_length = 0.0;
+    for (const auto& v : mesh.vertices) {
+        max_length = std::max(max_length, glm::length(v));
+    }
+
+    for (auto& v : mesh.vertices) {
+        v *= circumradius / max_length;
+    }
+}
+
+// A polyhedron given by its vertices and its faces as cycles of vertex
+// indices.
+struct Polyhedron {
+    std::vector<glm::dvec3> vertices;
+    std::vector<std::vector<u32>> faces;
+};
+
+// Build the prism of `base` with the given height. The prism has a copy of the
+// base at each end, and a prism cell over each face of the base.
+Mesh4 generate_prism(const Polyhedron& base, const f64 height, const GenerateProgress* progress) {
+    Mesh4 mesh;
+
+    // Edges of the base, numbered in the order they are first seen.
+    std::vector<Edge> base_edges;
+    std::vector<std::vector<u32>> base_face_edges;
+    {
+        std::unordered_map<Edge, u32> edge_index;
+        for (const auto& face : base.faces) {
+            std::vector<u32> face_edges;
+            for (size_t i = 0; i < face.size(); i++) {
+                const Edge edge(face[i], face[(i + 1) % face.size()]);
+                auto it = edge_index.find(edge);
+                if (it == edge_index.cend()) {
+                    it = edge_index.emplace(edge, (u32)base_edges.size()).first;
+                    base_edges.push_back(edge);
+                }
+                face_edges.push_back(it->second);
+            }
+            base_face_edges.push_back(std::move(face_edges));
+        }
+    }
+    if (progress && progress->cancelled()) {
+        return mesh;
+    }
+
+    const u32 n_base_vertices = (u32)base.vertices.size();
+    const u32 n_base_edges = (u32)base_edges.size();
+    const u32 n_base_faces = (u32)base.faces.size();
+
+    // Vertices: the base at w = -height / 2, then at w = height / 2.
+    for (s32 end = 0; end < 2; end++) {
+        const f64 w = end == 0 ? -height / 2.0 : height / 2.0;
+        for (const auto& v : base.vertices) {
+            mesh.vertices.emplace_back(v, w);
+        }
+    }
+
+    // Edges: the base edges at each end, then one edge joining the two copies
+    // of each base vertex.
+    for (u32 end = 0; end < 2; end++) {
+        for (const auto& edge : base_edges) {
+            mesh.edges.emplace_back(end * n_base_vertices + edge.v0, end * n_base_vertices + edge.v1);
+        }
+    }
+    for (u32 v = 0; v < n_base_vertices; v++) {
+        mesh.edges.emplace_back(v, n_base_vertices + v);
+    }
+    if (progress && progress->cancelled()) {
+        return mesh;
+    }
+
+    // Faces: the base faces at each end, then a square over each base edge.
+    for (u32 end = 0; end < 2; end++) {
+        for (const auto& face_edges : base_face_edges) {
+            Face face;
+            for (u32 e : face_edges) {
+                face.push_back(end * n_base_edges + e);
+            }
+            mesh.faces.push_back(std::move(face));
+        }
+    }
+    for (u32 e = 0; e < n_base_edges; e++) {
+        const u32 side_offset = 2 * n_base_edges;
+        mesh.faces.push_back(
+                {e, n_base_edges + e, side_offset + base_edges[e].v0, side_offset + base_edges[e].v1});
+    }
+    if (progress && progress->cancelled()) {
+        return mesh;
+    }
+
+    // Cells: the base at each end, then a prism over each base face.
+    for (u32 end = 0; end < 2; end++) {
+        Cell cell;
+        for (u32 f = 0; f < n_base_faces; f++) {
+            cell.push_back(end * n_base_faces + f);
+        }
+        mesh.cells.push_back(std::move(cell));
+    }
+    for (u32 f = 0; f < n_base_faces; f++) {
+        Cell cell = {f, n_base_faces + f};
+        for (u32 e : base_face_edges[f]) {
+            cell.push_back(2 * n_base_faces + e);
+        }
+        mesh.cells.push_back(std::move(cell));
+    }
+
+    return mesh;
+}
+} // namespace
+
+Mesh4 generate_duoprism(const u32 p, const u32 q, const GenerateProgress* progress) {
+    CHECK_GE_F(p, 3u);
+    CHECK_GE_F(q, 3u);
+
+    Mesh4 mesh;
+
+    // Vertex (i, j) is at angle i of the p-gon and angle j of the q-gon. Both
+    // polygons have unit edge length.
+    const f64 radius_p = 0.5 / sin(pi / p);
+    const f64 radius_q = 0.5 / sin(pi / q);
+
+    const auto vertex = [&](u32 i, u32 j) -> u32 { return (i % p) * q + j % q; };
+
+    mesh.vertices.reserve((size_t)p * q);
+    for (u32 i = 0; i < p; i++) {
+        if (progress && progress->cancelled()) {
+            return mesh;
+        }
+        const f64 a = 2.0 * pi * i / p;
+        for (u32 j = 0; j < q; j++) {
+            const f64 b = 2.0 * pi * j / q;
+            mesh.vertices.emplace_back(radius_p * cos(a), radius_p * sin(a), radius_q * cos(b), radius_q * sin(b));
+        }
+    }
+    if (progress && progress->cancelled()) {
+        return mesh;
+    }
+
+    // Edges: `p_edge(i, j)` joins (i, j) and (i + 1, j); `q_edge(i, j)` joins
+    // (i, j) and (i, j + 1).
+    const u32 n_p_edges = p * q;
+    const auto p_edge = [&](u32 i, u32 j) -> u32 { return (j % q) * p + i % p; };
+    const auto q_edge = [&](u32 i, u32 j) -> u32 { return n_p_edges + (i % p) * q + j % q; };
+
+    mesh.edges.reserve(2 * (size_t)p * q);
+    for (u32 j = 0; j < q; j++) {
+        for (u32 i = 0; i < p; i++) {
+            mesh.edges.emplace_back(vertex(i, j), vertex(i + 1, j));
+        }
+    }
+    for (u32 i = 0; i < p; i++) {
+        for (u32 j = 0; j < q; j++) {
+            mesh.edges.emplace_back(vertex(i, j), vertex(i, j + 1));
+        }
+    }
+    if (progress && progress->cancelled()) {
+        return mesh;
+    }
+
+    // Faces: q p-gons, then p q-gons, then a square for each vertex.
+    const auto p_gon = [&](u32 j) -> u32 { return j % q; };
+    const auto q_gon = [&](u32 i) -> u32 { return q + i % p; };
+    const auto square = [&](u32 i, u32 j) -> u32 { return q + p + i * q + j; };
+
+    mesh.faces.reserve((size_t)p + q + (size_t)p * q);
+    for (u32 j = 0; j < q; j++) {
+        Face face;
+        for (u32 i = 0; i < p; i++) {
+            face.push_back(p_edge(i, j));
+        }
+        mesh.faces.push_back(std::move(face));
+    }
+    for (u32 i = 0; i < p; i++) {
+        Face face;
+        for (u32 j = 0; j < q; j++) {
+            face.push_back(q_edge(i, j));
+        }
+        mesh.faces.push_back(std::move(face));
+    }
+    for (u32 i = 0; i < p; i++) {
+        if (progress && progress->cancelled()) {
+            return mesh;
+        }
+        for (u32 j = 0; j < q; j++) {
+            mesh.faces.push_back({p_edge(i, j), p_edge(i, j + 1), q_edge(i, j), q_edge(i + 1, j)});
+        }
+    }
+
+    // Cells: a p-gonal prism between each pair of neighbouring p-gons, and a
+    // q-gonal prism between each pair of neighbouring q-gons.
+    mesh.cells.reserve((size_t)p + q);
+    for (u32 j = 0; j < q; j++) {
+        Cell cell = {p_gon(j), p_gon(j + 1)};
+        for (u32 i = 0; i < p; i++) {
+            cell.push_back(square(i, j));
+        }
+        mesh.cells.push_back(std::move(cell));
+    }
+    for (u32 i = 0; i < p; i++) {
+        Cell cell = {q_gon(i), q_gon(i + 1)};
+        for (u32 j = 0; j < q; j++) {
+            cell.push_back(square(i, j));
+        }
+        mesh.cells.push_back(std::move(cell));
+    }
+
+    scale_to_circumradius(mesh);
+    mesh.name = strprintf("duoprism-%u-%u", p, q);
+    return mesh;
+}
+
+Mesh4 generate_polyhedral_prism(const s32 p, const s32 q, const bool (&rings)[3], GenerateProgress* progress) {
+    // The prism of a uniform polyhedron is the uniform 4-polytope whose
+    // diagram adds an unconnected ringed node to the polyhedron's diagram.
+    CoxeterDiagram diagram = {{p, q, 2}, {rings[0], rings[1], rings[2], true}};
+    Mesh4 mesh = generate_wythoff(diagram, progress);
+    mesh.name = strprintf("prism-%i-%i-%i%i%i", p, q, rings[0], rings[1], rings[2]);
+    return mesh;
+}
+
+Mesh4 generate_antiprismatic_prism(const u32 p, const GenerateProgress* progress) {
+    CHECK_GE_F(p, 3u);
+
+    // A uniform p-gonal antiprism with unit edge length: two p-gons, one
+    // rotated by half a step, joined by a band of 2p triangles.
+    Polyhedron antiprism;
+    const f64 radius = 0.5 / sin(pi / p);
+    const f64 height = sqrt(1.0 - 2.0 * sq(radius) * (1.0 - cos(pi / p)));
+
+    for (u32 ring = 0; ring < 2; ring++) {
+        const f64 z = ring == 0 ? -height / 2.0 : height / 2.0;
+        for (u32 i = 0; i < p; i++) {
+            const f64 a = 2.0 * pi * (i + 0.5 * ring) / p;
+            antiprism.vertices.emplace_back(radius * cos(a), radius * sin(a), z);
+        }
+    }
+
+    for (u32 ring = 0; ring < 2; ring++) {
+        std::vector<u32> face;
+        for (u32 i = 0; i < p; i++) {
+            face.push_back(ring * p + i);
+        }
+        antiprism.faces.push_back(std::move(face));
+    }
+    for (u32 i = 0; i < p; i++) {
+        const u32 next = (i + 1) % p;
+        antiprism.faces.push_back({i, next, p + i});
+        antiprism.faces.push_back({next, p + next, p + i});
+    }
+
+    Mesh4 mesh = generate_prism(antiprism, 1.0, progress);
+    scale_to_circumradius(mesh);
+    mesh.name = strprintf("antiprism-prism-%u", p);
+    return mesh;
+}
+
+} // namespace four
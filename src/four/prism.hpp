@@ -0,0 +1,24 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+namespace four {
+
+// Generators for the prism families of 4-polytopes. The topology of each is
+// built directly rather than searched for, so they can produce meshes of any
+// size for benchmarking. All results are uniform (every edge has the same
+// length) and scaled to a circumradius of 2. If `progress` is given and is
+// cancelled, they return early with an incomplete mesh.
+
+// The p,q-duoprism: the Cartesian product of a p-gon and a q-gon, with p
+// q-gonal prism cells and q p-gonal prism cells.
+Mesh4 generate_duoprism(u32 p, u32 q, const GenerateProgress* progress = NULL);
+
+// The prism of the uniform polyhedron with Coxeter diagram p,q and the given
+// rings, e.g. 4,3 with rings 100 is the cubic prism.
+Mesh4 generate_polyhedral_prism(s32 p, s32 q, const bool (&rings)[3], GenerateProgress* progress = NULL);
+
+// The prism of the p-gonal antiprism.
+Mesh4 generate_antiprismatic_prism(u32 p, const GenerateProgress* progress = NULL);
+
+} // namespace four
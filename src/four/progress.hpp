@@ -0,0 +1,30 @@
+#pragma once
+
+#include <four/utility.hpp>
+
+#include <atomic>
+
+namespace four {
+
+// Progress of a mesh generation that may be running on another thread. The
+// generating thread updates the stage and counts as it goes, and checks
+// `cancelled()` between units of work, returning early once it is set. Any
+// thread may read the counts or set `cancel`.
+struct GenerateProgress {
+    enum class Stage { vertices, edges, faces, cells, tetrahedralize };
+
+    std::atomic<Stage> stage = Stage::vertices;
+
+    std::atomic<u32> n_edges = 0;
+    std::atomic<u32> n_faces = 0;
+    std::atomic<u32> n_cells = 0;
+    std::atomic<u32> n_tetrahedralized_cells = 0;
+
+    std::atomic<bool> cancel = false;
+
+    bool cancelled() const {
+        return cancel.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace four
@@ -32,4 +32,17 @@ std::string get_resource_path(const char* relative_path) {
     result.append(relative_path);
     return result;
 }
+
+std::string get_cache_dir() {
+    char* pref_dir = SDL_GetPrefPath("psandbrook", "four");
+    if (!pref_dir) {
+        LOG_F(WARNING, "SDL_GetPrefPath() failed: %s", SDL_GetError());
+        return std::string();
+    }
+
+    std::string result(pref_dir);
+    SDL_free(pref_dir);
+    result.append("cache");
+    return result;
+}
 } // namespace four
@@ -12,4 +12,8 @@ void init_resource_path();
 // application's data directory.
 std::string get_resource_path(const char* relative_path);
 
+// Returns the directory for the application's cache, in the user's
+// preferences directory, or an empty string if there is none.
+std::string get_cache_dir();
+
 } // namespace four
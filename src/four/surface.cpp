@@ -0,0 +1,339 @@
+#include <four/surface.hpp>
+
+#include <four/parallel.hpp>
+#include <four/point_index.hpp>
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <math.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace four {
+
+namespace {
+
+constexpr f64 circumradius = 2.0;
+constexpr f64 pi = 3.14159265358979323846;
+
+// The six paths along the edges of a cube from its first corner to the
+// opposite one, as orders of the axes to step along.
+constexpr u32 kuhn_paths[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+constexpr u32 no_vertex = (u32)-1;
+
+// Builds a tessellated hypersurface from structured grids of points. Each cube
+// of a grid is split into the six tetrahedra around its main diagonal (the
+// Kuhn triangulation). Neighbouring cubes split their shared square along the
+// same diagonal, so the tetrahedra meet face to face across cubes, across the
+// seams of periodic axes, and across grids whose shared boundary has its axes
+// in the same directions. Points that coincide, such as the poles of a sphere,
+// are welded together, and tetrahedra that this flattens are dropped.
+struct SurfaceBuilder {
+    const GenerateProgress* progress;
+    PointIndex4 point_index;
+    std::vector<glm::dvec4> vertices;
+    std::vector<std::array<u32, 4>> tets;
+
+    explicit SurfaceBuilder(const GenerateProgress* progress) : progress(progress) {}
+
+    bool cancelled() const {
+        return progress && progress->cancelled();
+    }
+
+    u32 weld(const glm::dvec4& p) {
+        u32 index;
+        if (!point_index.find(p, index)) {
+            index = (u32)vertices.size();
+            point_index.insert(p, index);
+            vertices.push_back(p);
+        }
+        return index;
+    }
+
+    // Add a grid with `segments[i]` cubes along axis i. `position(t)` gives the
+    // point at grid coordinates `t` in [0, 1]^3, and must be safe to call from
+    // many threads. Along a periodic axis the point at 1 is the one at 0. Does
+    // nothing once the generation is cancelled.
+    template <class Position>
+    void add_grid(const u32 (&segments)[3], const bool (&periodic)[3], Position&& position) {
+        if (cancelled()) {
+            return;
+        }
+
+        u32 nodes[3];
+        for (s32 i = 0; i < 3; i++) {
+            nodes[i] = periodic[i] ? segments[i] : segments[i] + 1;
+        }
+
+        const auto node = [&](u32 i, u32 j, u32 k) -> u32 {
+            return ((i % nodes[0]) * nodes[1] + j % nodes[1]) * nodes[2] + k % nodes[2];
+        };
+
+        // Positions are independent, so they are evaluated a slab at a time in
+        // parallel; welding them must then be done in order.
+        std::vector<glm::dvec4> points((size_t)nodes[0] * nodes[1] * nodes[2]);
+        parallel_for("grid", nodes[0], hardware_threads(), [&](u32 i, u32) {
+            for (u32 j = 0; j < nodes[1]; j++) {
+                for (u32 k = 0; k < nodes[2]; k++) {
+                    const glm::dvec3 t((f64)i / segments[0], (f64)j / segments[1], (f64)k / segments[2]);
+                    points[node(i, j, k)] = position(t);
+                }
+            }
+        });
+
+        std::vector<u32> node_vertices(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            if (i % 4096 == 0 && cancelled()) {
+                return;
+            }
+            node_vertices[i] = weld(points[i]);
+        }
+
+        // Every cube has a slot for each of its six tetrahedra, so the slabs
+        // can be filled in parallel and the result does not depend on the
+        // order they run in.
+        const size_t slab_size = 6 * (size_t)segments[1] * segments[2];
+        std::vector<std::array<u32, 4>> slots(slab_size * segments[0]);
+        parallel_for("grid", segments[0], hardware_threads(), [&](u32 i, u32) {
+            size_t slot = slab_size * i;
+            for (u32 j = 0; j < segments[1]; j++) {
+                for (u32 k = 0; k < segments[2]; k++) {
+                    for (const auto& path : kuhn_paths) {
+                        u32 corner[3] = {i, j, k};
+                        auto& tet = slots[slot++];
+                        tet[0] = node_vertices[node(corner[0], corner[1], corner[2])];
+                        for (s32 step = 0; step < 3; step++) {
+                            corner[path[step]]++;
+                            tet[(size_t)step + 1] = node_vertices[node(corner[0], corner[1], corner[2])];
+                        }
+
+                        for (s32 a = 0; a < 4; a++) {
+                            for (s32 b = a + 1; b < 4; b++) {
+                                if (tet[(size_t)a] == tet[(size_t)b]) {
+                                    tet[0] = no_vertex;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        for (const auto& tet : slots) {
+            if (tet[0] != no_vertex) {
+                tets.push_back(tet);
+            }
+        }
+    }
+
+    // Build the edges, faces and cells of the mesh from the tetrahedra. Faces
+    // and edges are numbered in sorted order of their vertices, so the result
+    // is the same on every run. If the generation is cancelled, the result is
+    // incomplete.
+    Mesh4 finish(std::string name) {
+        Mesh4 mesh;
+        mesh.name = std::move(name);
+        if (cancelled()) {
+            return mesh;
+        }
+        mesh.vertices = vertices;
+
+        const u32 n_tets = (u32)tets.size();
+        mesh.tet_vertices = vertices;
+        mesh.tets.resize(n_tets);
+        mesh.cells.assign(n_tets, Cell(4));
+
+        // Faces: each triangle of each tetrahedron, sorted so that the copies
+        // of a triangle shared by two tetrahedra are next to each other.
+        struct Triangle {
+            std::array<u32, 3> vertices;
+            u32 cell_face;
+        };
+
+        std::vector<Triangle> triangles((size_t)n_tets * 4);
+        parallel_for("faces", n_tets, hardware_threads(), [&](u32 t, u32) {
+            mesh.tets[t].cell = t;
+            for (s32 i = 0; i < 4; i++) {
+                mesh.tets[t].vertices[i] = tets[t][(size_t)i];
+            }
+
+            for (u32 omit = 0; omit < 4; omit++) {
+                Triangle& triangle = triangles[(size_t)t * 4 + omit];
+                size_t n = 0;
+                for (u32 i = 0; i < 4; i++) {
+                    if (i != omit) {
+                        triangle.vertices[n++] = tets[t][i];
+                    }
+                }
+                std::sort(triangle.vertices.begin(), triangle.vertices.end());
+                triangle.cell_face = t * 4 + omit;
+            }
+        });
+
+        std::sort(triangles.begin(), triangles.end(), [](const Triangle& a, const Triangle& b) {
+            return a.vertices != b.vertices ? a.vertices < b.vertices : a.cell_face < b.cell_face;
+        });
+
+        std::vector<std::array<u32, 3>> face_vertices;
+        for (size_t i = 0; i < triangles.size(); i++) {
+            if (i == 0 || triangles[i].vertices != triangles[i - 1].vertices) {
+                face_vertices.push_back(triangles[i].vertices);
+            }
+            const u32 cell_face = triangles[i].cell_face;
+            mesh.cells[cell_face / 4][cell_face % 4] = (u32)face_vertices.size() - 1;
+        }
+        triangles = {};
+        if (cancelled()) {
+            return mesh;
+        }
+
+        // Edges: likewise, each side of each face.
+        struct Side {
+            std::array<u32, 2> vertices;
+            u32 face_edge;
+        };
+
+        const u32 n_faces = (u32)face_vertices.size();
+        std::vector<Side> sides((size_t)n_faces * 3);
+        for (u32 f = 0; f < n_faces; f++) {
+            const auto& v = face_vertices[f];
+            sides[(size_t)f * 3 + 0] = {{v[0], v[1]}, f * 3 + 0};
+            sides[(size_t)f * 3 + 1] = {{v[0], v[2]}, f * 3 + 1};
+            sides[(size_t)f * 3 + 2] = {{v[1], v[2]}, f * 3 + 2};
+        }
+
+        std::sort(sides.begin(), sides.end(), [](const Side& a, const Side& b) {
+            return a.vertices != b.vertices ? a.vertices < b.vertices : a.face_edge < b.face_edge;
+        });
+
+        mesh.faces.assign(n_faces, Face(3));
+        for (size_t i = 0; i < sides.size(); i++) {
+            if (i == 0 || sides[i].vertices != sides[i - 1].vertices) {
+                mesh.edges.emplace_back(sides[i].vertices[0], sides[i].vertices[1]);
+            }
+            const u32 face_edge = sides[i].face_edge;
+            mesh.faces[face_edge / 3][face_edge % 3] = (u32)mesh.edges.size() - 1;
+        }
+
+        LOG_F(INFO, "Generated %s with %lu vertices, %lu edges, %lu faces and %lu cells", mesh.name.c_str(),
+              mesh.vertices.size(), mesh.edges.size(), mesh.faces.size(), mesh.cells.size());
+
+        return mesh;
+    }
+};
+} // namespace
+
+Mesh4 generate_3sphere(const u32 resolution, const GenerateProgress* progress) {
+    CHECK_GE_F(resolution, 8u);
+
+    // Hopf coordinates: the point (η, ξ1, ξ2) is (cos η e^iξ1, sin η e^iξ2),
+    // with η in [0, π/2]. The circles of ξ2 at η = 0 and of ξ1 at η = π/2
+    // shrink to points, which the builder welds.
+    SurfaceBuilder builder(progress);
+    const u32 segments[3] = {resolution / 4, resolution, resolution};
+    const bool periodic[3] = {false, true, true};
+    builder.add_grid(segments, periodic, [](const glm::dvec3& t) {
+        const f64 eta = t[0] * pi / 2.0;
+        const f64 xi1 = t[1] * 2.0 * pi;
+        const f64 xi2 = t[2] * 2.0 * pi;
+        return circumradius
+               * glm::dvec4(cos(eta) * cos(xi1), cos(eta) * sin(xi1), sin(eta) * cos(xi2), sin(eta) * sin(xi2));
+    });
+
+    return builder.finish(strprintf("3-sphere-%u", resolution));
+}
+
+Mesh4 generate_clifford_torus(const u32 resolution, const GenerateProgress* progress) {
+    CHECK_GE_F(resolution, 8u);
+
+    // The Clifford torus of radius `radius` in each of the xy and zw planes,
+    // and a tube around it of radius `tube`. The point (a, b, c) is at angle a
+    // in the xy plane, angle b in the zw plane and angle c around the tube.
+    constexpr f64 tube = 0.5;
+    const f64 radius = (circumradius - tube) / sqrt(2.0);
+
+    SurfaceBuilder builder(progress);
+    const u32 segments[3] = {resolution, resolution, resolution / 2};
+    const bool periodic[3] = {true, true, true};
+    builder.add_grid(segments, periodic, [&](const glm::dvec3& t) {
+        const f64 a = t[0] * 2.0 * pi;
+        const f64 b = t[1] * 2.0 * pi;
+        const f64 c = t[2] * 2.0 * pi;
+        const f64 r_xy = radius + tube * cos(c);
+        const f64 r_zw = radius + tube * sin(c);
+        return glm::dvec4(r_xy * cos(a), r_xy * sin(a), r_zw * cos(b), r_zw * sin(b));
+    });
+
+    return builder.finish(strprintf("clifford-torus-%u", resolution));
+}
+
+Mesh4 generate_spherinder(const u32 resolution, const GenerateProgress* progress) {
+    CHECK_GE_F(resolution, 8u);
+
+    // A ball of radius `radius` in xyz, extruded from w = -`half_height` to w =
+    // `half_height`. The side is the sphere at each w, on a grid of (polar
+    // angle, azimuth, w); each end is a flat ball, on a grid of (polar angle,
+    // azimuth, distance from its centre) so that it shares its sphere with the
+    // side. Only the sphere is curved, so the other axes need one segment.
+    const f64 half_height = circumradius / sqrt(2.0);
+    const f64 radius = circumradius / sqrt(2.0);
+
+    const auto sphere = [&](f64 theta, f64 phi) -> glm::dvec3 {
+        return radius * glm::dvec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+    };
+
+    SurfaceBuilder builder(progress);
+    const u32 segments[3] = {resolution / 2, resolution, 1};
+    const bool periodic[3] = {false, true, false};
+
+    builder.add_grid(segments, periodic, [&](const glm::dvec3& t) {
+        return glm::dvec4(sphere(t[0] * pi, t[1] * 2.0 * pi), (2.0 * t[2] - 1.0) * half_height);
+    });
+    for (f64 w : {-half_height, half_height}) {
+        builder.add_grid(segments, periodic,
+                         [&](const glm::dvec3& t) { return glm::dvec4(t[2] * sphere(t[0] * pi, t[1] * 2.0 * pi), w); });
+    }
+
+    return builder.finish(strprintf("spherinder-%u", resolution));
+}
+
+Mesh4 generate_cubinder(const u32 resolution, const GenerateProgress* progress) {
+    CHECK_GE_F(resolution, 8u);
+
+    // A disk of radius `radius` in xy times the square of side 2 `half_side`
+    // in zw. The side is the circle times the square, on a grid of (angle, z,
+    // w); each of the four ends is a flat cylinder, on a grid of (angle, the
+    // free coordinate of z and w, distance from the axis). Only the circle is
+    // curved, so the other axes need one segment.
+    const f64 radius = circumradius / sqrt(3.0);
+    const f64 half_side = circumradius / sqrt(3.0);
+
+    const auto circle = [&](f64 a) -> glm::dvec2 { return radius * glm::dvec2(cos(a), sin(a)); };
+    const auto side = [&](f64 t) -> f64 { return (2.0 * t - 1.0) * half_side; };
+
+    SurfaceBuilder builder(progress);
+    const u32 segments[3] = {resolution, 1, 1};
+    const bool periodic[3] = {true, false, false};
+
+    builder.add_grid(segments, periodic, [&](const glm::dvec3& t) {
+        return glm::dvec4(circle(t[0] * 2.0 * pi), side(t[1]), side(t[2]));
+    });
+    for (f64 z : {-half_side, half_side}) {
+        builder.add_grid(segments, periodic, [&](const glm::dvec3& t) {
+            return glm::dvec4(t[2] * circle(t[0] * 2.0 * pi), z, side(t[1]));
+        });
+    }
+    for (f64 w : {-half_side, half_side}) {
+        builder.add_grid(segments, periodic, [&](const glm::dvec3& t) {
+            return glm::dvec4(t[2] * circle(t[0] * 2.0 * pi), side(t[1]), w);
+        });
+    }
+
+    return builder.finish(strprintf("cubinder-%u", resolution));
+}
+
+} // namespace four
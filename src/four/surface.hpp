@@ -0,0 +1,30 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+namespace four {
+
+// Generators for tessellations of smooth hypersurfaces. Each surface is built
+// from structured grids of points whose cubes are split into tetrahedra, and
+// every tetrahedron is a cell of its own, so the result already has its
+// `tet_vertices` and `tets` filled in and does not need to be passed to
+// `tetrahedralize`. `resolution` is the number of segments around each full
+// circle of the surface, and must be at least 8. All results are scaled to a
+// circumradius of 2. If `progress` is given and is cancelled, they return early
+// with an incomplete mesh.
+
+// The 3-sphere, on a grid of Hopf coordinates.
+Mesh4 generate_3sphere(u32 resolution, const GenerateProgress* progress = NULL);
+
+// The boundary of a tubular neighbourhood of the Clifford torus: the points at
+// a fixed distance from the flat torus that divides the 3-sphere into two
+// solid tori. The Clifford torus itself is only two-dimensional.
+Mesh4 generate_clifford_torus(u32 resolution, const GenerateProgress* progress = NULL);
+
+// The boundary of the Cartesian product of a ball and a line segment.
+Mesh4 generate_spherinder(u32 resolution, const GenerateProgress* progress = NULL);
+
+// The boundary of the Cartesian product of a disk and a square.
+Mesh4 generate_cubinder(u32 resolution, const GenerateProgress* progress = NULL);
+
+} // namespace four
@@ -4,9 +4,11 @@
 #include <cmath>
 #include <functional>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include <loguru.hpp>
 
@@ -200,6 +202,25 @@ inline bool c_str_eq(const char* lhs, const char* rhs) {
     return strcmp(lhs, rhs) == 0;
 }
 
+// Read the whole file at `path` into `out`. Returns false if it cannot be read.
+inline bool read_file(const char* path, std::vector<char>& out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    out.clear();
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
 struct CStrHash {
     size_t operator()(const char* x) const {
         size_t hash = 0;
@@ -0,0 +1,248 @@
+#include <four/volume.hpp>
+
+#include <four/operators.hpp>
+#include <four/parallel.hpp>
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace four {
+
+namespace {
+
+// Pentatopes are handed to workers in blocks, so that the cost of
+// distributing work is small next to the work.
+constexpr u32 block_size = 1024;
+
+u32 n_blocks(const size_t n) {
+    return (u32)((n + block_size - 1) / block_size);
+}
+
+// The signed 4-volume of the parallelotope with the given edges, which is 24
+// times that of the pentatope with them.
+f64 det4(const glm::dvec4& a, const glm::dvec4& b, const glm::dvec4& c, const glm::dvec4& d) {
+    return glm::dot(cross(a, b, c), d);
+}
+
+f64 pentatope_det(const VolumeMesh4& mesh, const VolumeMesh4::Pentatope& p) {
+    const glm::dvec4& v0 = mesh.vertices[p.vertices[0]];
+    return det4(mesh.vertices[p.vertices[1]] - v0, mesh.vertices[p.vertices[2]] - v0,
+                mesh.vertices[p.vertices[3]] - v0, mesh.vertices[p.vertices[4]] - v0);
+}
+
+} // namespace
+
+bool mesh_interior(const Mesh4& mesh, VolumeMesh4& out) {
+    out.vertices.clear();
+    out.pentatopes.clear();
+
+    if (mesh.tets.empty() || mesh.vertices.empty()) {
+        LOG_F(ERROR, "%s has not been tetrahedralized", mesh.name.c_str());
+        return false;
+    }
+    // Every pentatope is then on the inner side of its tetrahedron's cell, so
+    // they do not overlap.
+    if (!is_convex(mesh, "fill the interior of")) {
+        return false;
+    }
+
+    glm::dvec4 centroid(0, 0, 0, 0);
+    for (const auto& v : mesh.vertices) {
+        centroid += v;
+    }
+    centroid /= (f64)mesh.vertices.size();
+
+    f64 size = 0.0;
+    for (const auto& v : mesh.vertices) {
+        size = std::max(size, glm::length(v - centroid));
+    }
+    const f64 tolerance = sq(sq(size)) * 0.000000001;
+
+    out.vertices.reserve(mesh.tet_vertices.size() + 1);
+    out.vertices.insert(out.vertices.end(), mesh.tet_vertices.begin(), mesh.tet_vertices.end());
+    const u32 centre = (u32)insert_back(out.vertices, centroid);
+
+    out.pentatopes.resize(mesh.tets.size());
+    std::atomic<u32> n_flat = 0;
+    parallel_for("mesh interior", n_blocks(mesh.tets.size()), hardware_threads(), [&](u32 block, u32) {
+        const size_t begin = (size_t)block * block_size;
+        const size_t end = std::min(begin + block_size, mesh.tets.size());
+        for (size_t i = begin; i < end; i++) {
+            const Mesh4::Tet& tet = mesh.tets[i];
+            VolumeMesh4::Pentatope& p = out.pentatopes[i];
+            p.cell = tet.cell;
+            p.vertices[0] = centre;
+            std::copy(std::begin(tet.vertices), std::end(tet.vertices), p.vertices + 1);
+
+            const f64 det = pentatope_det(out, p);
+            if (std::abs(det) <= tolerance) {
+                n_flat.fetch_add(1, std::memory_order_relaxed);
+            } else if (det < 0.0) {
+                std::swap(p.vertices[3], p.vertices[4]);
+            }
+        }
+    });
+
+    if (n_flat > 0) {
+        LOG_F(ERROR, "Cannot fill the interior of %s: %u of its tetrahedra are flat", mesh.name.c_str(),
+              n_flat.load());
+        out.vertices.clear();
+        out.pentatopes.clear();
+        return false;
+    }
+    return true;
+}
+
+void slice_volume(const VolumeMesh4& mesh, const glm::dvec4& normal, const f64 offset, VolumeSlice& out) {
+    out.vertices.clear();
+    out.tets.clear();
+
+    // The slice of each block of pentatopes, with vertex indices relative to
+    // the block.
+    struct BlockSlice {
+        std::vector<glm::dvec4> vertices;
+        std::vector<Mesh4::Tet> tets;
+    };
+
+    // Vertices closer to the hyperplane than this are taken to be in it.
+    f64 size = 0.0;
+    for (const auto& v : mesh.vertices) {
+        size = std::max(size, glm::length(v));
+    }
+    const f64 tolerance = size * 0.000000000001;
+
+    const u32 n = n_blocks(mesh.pentatopes.size());
+    std::vector<BlockSlice> blocks(n);
+    parallel_for("slice volume", n, hardware_threads(), [&](u32 block, u32) {
+        BlockSlice& result = blocks[block];
+        const size_t begin = (size_t)block * block_size;
+        const size_t end = std::min(begin + block_size, mesh.pentatopes.size());
+
+        for (size_t i = begin; i < end; i++) {
+            const VolumeMesh4::Pentatope& p = mesh.pentatopes[i];
+
+            // Split the vertices by side. Vertices in the hyperplane count as
+            // below it, so each point where an edge crosses is well defined.
+            u32 above[5];
+            u32 below[5];
+            f64 distances[5];
+            u32 n_above = 0;
+            u32 n_below = 0;
+            for (u32 j = 0; j < 5; j++) {
+                distances[j] = glm::dot(normal, mesh.vertices[p.vertices[j]]) - offset;
+                if (std::abs(distances[j]) <= tolerance) {
+                    distances[j] = 0.0;
+                }
+                if (distances[j] > 0.0) {
+                    above[n_above++] = j;
+                } else {
+                    below[n_below++] = j;
+                }
+            }
+            if (n_above == 0 || n_below == 0) {
+                continue;
+            }
+
+            // The smaller side is `a`, the larger `b`.
+            const u32* a = n_above < n_below ? above : below;
+            const u32* b = n_above < n_below ? below : above;
+            const u32 n_a = std::min(n_above, n_below);
+
+            // The point where the edge from a[i] to b[j] crosses the
+            // hyperplane. Where that is at a vertex in the hyperplane, the
+            // edges through it share the point.
+            u32 vertex_points[5] = {(u32)-1, (u32)-1, (u32)-1, (u32)-1, (u32)-1};
+            const auto crossing = [&](u32 i, u32 j) {
+                const glm::dvec4& va = mesh.vertices[p.vertices[a[i]]];
+                const glm::dvec4& vb = mesh.vertices[p.vertices[b[j]]];
+                const f64 t = distances[a[i]] / (distances[a[i]] - distances[b[j]]);
+                if (t <= 0.0 || t >= 1.0) {
+                    const u32 at = t <= 0.0 ? a[i] : b[j];
+                    if (vertex_points[at] == (u32)-1) {
+                        vertex_points[at] = (u32)insert_back(result.vertices, t <= 0.0 ? va : vb);
+                    }
+                    return vertex_points[at];
+                }
+                return (u32)insert_back(result.vertices, va + t * (vb - va));
+            };
+
+            // Tetrahedra with a repeated point, left where the hyperplane
+            // passes through vertices, are flat and dropped.
+            const auto add_tet = [&](u32 v0, u32 v1, u32 v2, u32 v3) {
+                if (v0 == v1 || v0 == v2 || v0 == v3 || v1 == v2 || v1 == v3 || v2 == v3) {
+                    return;
+                }
+                Mesh4::Tet tet;
+                tet.cell = p.cell;
+                tet.vertices[0] = v0;
+                tet.vertices[1] = v1;
+                tet.vertices[2] = v2;
+                tet.vertices[3] = v3;
+                result.tets.push_back(tet);
+            };
+
+            if (n_a == 1) {
+                const u32 x0 = crossing(0, 0);
+                const u32 x1 = crossing(0, 1);
+                const u32 x2 = crossing(0, 2);
+                const u32 x3 = crossing(0, 3);
+                add_tet(x0, x1, x2, x3);
+            } else {
+                // A triangular prism, with a triangle at each end of `a`.
+                DCHECK_EQ_F(n_a, 2u);
+                const u32 x0 = crossing(0, 0);
+                const u32 x1 = crossing(0, 1);
+                const u32 x2 = crossing(0, 2);
+                const u32 y0 = crossing(1, 0);
+                const u32 y1 = crossing(1, 1);
+                const u32 y2 = crossing(1, 2);
+                add_tet(x0, x1, x2, y2);
+                add_tet(x0, x1, y1, y2);
+                add_tet(x0, y0, y1, y2);
+            }
+        }
+    });
+
+    size_t n_vertices = 0;
+    size_t n_tets = 0;
+    for (const auto& block : blocks) {
+        n_vertices += block.vertices.size();
+        n_tets += block.tets.size();
+    }
+    out.vertices.reserve(n_vertices);
+    out.tets.reserve(n_tets);
+
+    for (const auto& block : blocks) {
+        const u32 base = (u32)out.vertices.size();
+        out.vertices.insert(out.vertices.end(), block.vertices.begin(), block.vertices.end());
+        for (Mesh4::Tet tet : block.tets) {
+            for (u32& v_i : tet.vertices) {
+                v_i += base;
+            }
+            out.tets.push_back(tet);
+        }
+    }
+}
+
+f64 hypervolume(const VolumeMesh4& mesh) {
+    f64 result = 0.0;
+    for (const auto& p : mesh.pentatopes) {
+        result += std::abs(pentatope_det(mesh, p));
+    }
+    return result / 24.0;
+}
+
+f64 volume(const VolumeSlice& slice) {
+    f64 result = 0.0;
+    for (const auto& tet : slice.tets) {
+        const glm::dvec4& v0 = slice.vertices[tet.vertices[0]];
+        result += glm::length(cross(slice.vertices[tet.vertices[1]] - v0, slice.vertices[tet.vertices[2]] - v0,
+                                    slice.vertices[tet.vertices[3]] - v0));
+    }
+    return result / 6.0;
+}
+
+} // namespace four
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+#include <vector>
+
+namespace four {
+
+// A solid 4D object: the interior of a `Mesh4` split into pentatopes
+// (4-simplices). Where a cross section of a `Mesh4` is a hollow surface, a
+// cross section of a `VolumeMesh4` is a filled 3D volume.
+struct VolumeMesh4 {
+
+    struct Pentatope {
+
+        // Index of the boundary mesh's `cells` vector: the cell the
+        // pentatope stands on.
+        u32 cell;
+
+        // Array of indices of the `vertices` vector, in an order that gives
+        // the pentatope a positive orientation.
+        u32 vertices[5];
+    };
+
+    std::vector<glm::dvec4> vertices;
+    std::vector<Pentatope> pentatopes;
+};
+
+// A cross section of a `VolumeMesh4`, split into tetrahedra.
+struct VolumeSlice {
+
+    // Points in the slicing hyperplane. Each pentatope's points are its own,
+    // so that pentatopes can be sliced independently.
+    std::vector<glm::dvec4> vertices;
+
+    // Indices of `vertices`. The cell of each tetrahedron is that of the
+    // pentatope it was cut from.
+    std::vector<Mesh4::Tet> tets;
+};
+
+// Fill the interior of the tetrahedralized `mesh` with a pentatope for each of
+// its tetrahedra, joining the tetrahedron to the centroid of the mesh's
+// vertices. `out.vertices` is the mesh's `tet_vertices` followed by the
+// centroid. The mesh must be the boundary of a convex polytope around its
+// centroid, as checked by `is_convex`, so that the pentatopes do not overlap.
+// Returns false and logs an error if it is not, if the mesh has no tetrahedra,
+// or if a pentatope would be flat.
+bool mesh_interior(const Mesh4& mesh, VolumeMesh4& out);
+
+// Cut `mesh` with the hyperplane of points `p` where `dot(normal, p) ==
+// offset`. Each pentatope the hyperplane crosses leaves a tetrahedron, or a
+// triangular prism that is split into three tetrahedra. Pentatopes are sliced
+// in parallel, and the result is the same as if they were done in order.
+void slice_volume(const VolumeMesh4& mesh, const glm::dvec4& normal, f64 offset, VolumeSlice& out);
+
+// The 4-volume of `mesh`.
+f64 hypervolume(const VolumeMesh4& mesh);
+
+// The 3-volume of `slice`.
+f64 volume(const VolumeSlice& slice);
+
+} // namespace four
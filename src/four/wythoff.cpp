@@ -0,0 +1,399 @@
+#include <four/wythoff.hpp>
+
+#include <four/point_index.hpp>
+#include <four/utility.hpp>
+
+#include <loguru.hpp>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace four {
+
+namespace {
+
+constexpr s32 n_mirrors = 4;
+constexpr u32 max_vertices = 1u << 22;
+constexpr f64 circumradius = 2.0;
+constexpr long double pi = 3.141592653589793238462643383279502884L;
+
+// Points are built up by long chains of reflections, so they are kept in
+// extended precision until the orbit is complete. Otherwise the rounding error
+// of deep vertices is large enough that cells are measurably non-planar.
+using Point = std::array<long double, 4>;
+
+glm::dvec4 to_dvec4(const Point& p) {
+    return glm::dvec4((f64)p[0], (f64)p[1], (f64)p[2], (f64)p[3]);
+}
+
+// The elements of one rank (edges, faces or cells) of the polytope. Each
+// element is a sorted list of indices of elements of the rank below.
+struct RankElements {
+    std::vector<std::vector<u32>> elements;
+
+    // `action[e * n_mirrors + s]` is the index of the image of element `e`
+    // under reflection `s`.
+    std::vector<u32> action;
+
+    std::unordered_map<std::vector<u32>, u32, SortedIndicesHash> index;
+
+    u32 find_or_add(const std::vector<u32>& key) {
+        auto it = index.find(key);
+        if (it != index.cend()) {
+            return it->second;
+        }
+
+        u32 result = (u32)elements.size();
+        index.emplace(key, result);
+        elements.push_back(key);
+        return result;
+    }
+
+    // Add every image of the elements under the reflection group, filling in
+    // `action`. Images are appended while iterating, so this visits the whole
+    // orbit of every element present when it is called. Returns false if
+    // `progress` is cancelled first.
+    bool close(const std::vector<u32>& lower_action, const GenerateProgress* progress) {
+        std::vector<u32> image;
+        for (u32 e = 0; e < elements.size(); e++) {
+            if (e % 1024 == 0 && progress && progress->cancelled()) {
+                return false;
+            }
+            for (s32 s = 0; s < n_mirrors; s++) {
+                image.clear();
+                for (u32 lower_i : elements[e]) {
+                    image.push_back(lower_action[lower_i * n_mirrors + (u32)s]);
+                }
+                std::sort(image.begin(), image.end());
+                u32 image_i = find_or_add(image);
+                action.push_back(image_i);
+            }
+        }
+        return true;
+    }
+};
+
+// Collect the orbit of the elements `start` of one rank under the reflections
+// selected by `mirrors`. The result is sorted.
+std::vector<u32> local_orbit(const std::vector<u32>& start, const std::vector<u32>& action, u32 n_elements,
+                             u32 mirrors) {
+    std::vector<bool> seen(n_elements, false);
+    std::vector<u32> result;
+
+    for (u32 e : start) {
+        if (!seen[e]) {
+            seen[e] = true;
+            result.push_back(e);
+        }
+    }
+
+    for (size_t i = 0; i < result.size(); i++) {
+        for (s32 s = 0; s < n_mirrors; s++) {
+            if (mirrors & (1u << s)) {
+                u32 image = action[result[i] * n_mirrors + (u32)s];
+                if (!seen[image]) {
+                    seen[image] = true;
+                    result.push_back(image);
+                }
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+u32 ring_mask(const CoxeterDiagram& diagram) {
+    u32 result = 0;
+    for (s32 i = 0; i < n_mirrors; i++) {
+        if (diagram.rings[i]) {
+            result |= 1u << i;
+        }
+    }
+    return result;
+}
+
+// A set of mirrors generates a non-degenerate element of the polytope if every
+// connected component of its subdiagram contains a ringed node.
+bool is_active_subset(const CoxeterDiagram& diagram, u32 mirrors) {
+    const u32 rings = ring_mask(diagram);
+    s32 i = 0;
+    while (i < n_mirrors) {
+        if (!(mirrors & (1u << i))) {
+            i++;
+            continue;
+        }
+
+        bool component_ringed = false;
+        s32 j = i;
+        while (true) {
+            if (rings & (1u << j)) {
+                component_ringed = true;
+            }
+            if (j + 1 < n_mirrors && (mirrors & (1u << (j + 1))) && diagram.branches[j] > 2) {
+                j++;
+            } else {
+                break;
+            }
+        }
+
+        if (!component_ringed) {
+            return false;
+        }
+        i = j + 1;
+    }
+
+    return true;
+}
+
+u32 popcount(u32 x) {
+    u32 result = 0;
+    for (; x != 0; x &= x - 1) {
+        result++;
+    }
+    return result;
+}
+
+// Calculate the unit normals of the mirrors from the Gram matrix of the
+// diagram, using a Cholesky decomposition. The normals are the rows of the
+// lower triangular factor. Returns false if the Gram matrix is not positive
+// definite, i.e. the group is infinite.
+bool mirror_normals(const CoxeterDiagram& diagram, Point (&normals)[n_mirrors]) {
+    long double gram[n_mirrors][n_mirrors] = {};
+    for (s32 i = 0; i < n_mirrors; i++) {
+        gram[i][i] = 1.0L;
+    }
+    for (s32 i = 0; i < n_mirrors - 1; i++) {
+        long double c = -cosl(pi / diagram.branches[i]);
+        gram[i][i + 1] = c;
+        gram[i + 1][i] = c;
+    }
+
+    for (auto& n : normals) {
+        n = {};
+    }
+    for (s32 i = 0; i < n_mirrors; i++) {
+        for (s32 j = 0; j <= i; j++) {
+            long double sum = gram[i][j];
+            for (s32 k = 0; k < j; k++) {
+                sum -= normals[i][(size_t)k] * normals[j][(size_t)k];
+            }
+
+            if (i == j) {
+                if (sum <= 0.000001L) {
+                    return false;
+                }
+                normals[i][(size_t)i] = sqrtl(sum);
+            } else {
+                normals[i][(size_t)j] = sum / normals[j][(size_t)j];
+            }
+        }
+    }
+    return true;
+}
+
+Point reflect(const Point& p, const Point& n) {
+    long double dot = 0;
+    for (size_t i = 0; i < 4; i++) {
+        dot += p[i] * n[i];
+    }
+
+    Point result;
+    for (size_t i = 0; i < 4; i++) {
+        result[i] = p[i] - 2 * dot * n[i];
+    }
+    return result;
+}
+} // namespace
+
+bool parse_coxeter_diagram(const char* str, CoxeterDiagram& out) {
+    CoxeterDiagram result = {};
+    const char* c = str;
+
+    for (s32 i = 0; i < 3; i++) {
+        char* end;
+        long value = strtol(c, &end, 10);
+        if (end == c || value < 2 || value > 1000) {
+            LOG_F(ERROR, "Invalid branch label in Coxeter diagram \"%s\"", str);
+            return false;
+        }
+        result.branches[i] = (s32)value;
+        c = end;
+
+        const char separator = i < 2 ? ',' : ':';
+        if (*c != separator) {
+            LOG_F(ERROR, "Expected '%c' in Coxeter diagram \"%s\"", separator, str);
+            return false;
+        }
+        c++;
+    }
+
+    bool any_ring = false;
+    for (s32 i = 0; i < n_mirrors; i++) {
+        if (c[i] != '0' && c[i] != '1') {
+            LOG_F(ERROR, "Expected 4 ring flags (0 or 1) in Coxeter diagram \"%s\"", str);
+            return false;
+        }
+        result.rings[i] = c[i] == '1';
+        any_ring = any_ring || result.rings[i];
+    }
+
+    if (c[n_mirrors] != '\0') {
+        LOG_F(ERROR, "Trailing characters in Coxeter diagram \"%s\"", str);
+        return false;
+    }
+
+    if (!any_ring) {
+        LOG_F(ERROR, "Coxeter diagram \"%s\" has no ringed nodes", str);
+        return false;
+    }
+
+    Point normals[n_mirrors];
+    if (!mirror_normals(result, normals)) {
+        LOG_F(ERROR, "Coxeter diagram \"%s\" does not describe a finite group", str);
+        return false;
+    }
+
+    out = result;
+    return true;
+}
+
+Mesh4 generate_wythoff(const CoxeterDiagram& diagram, GenerateProgress* progress) {
+    Point normals[n_mirrors];
+    CHECK_F(mirror_normals(diagram, normals));
+
+    // The generating point is at distance 1 from each ringed mirror and lies on
+    // every other mirror. The normals form a lower triangular matrix, so this
+    // is solved by forward substitution.
+    Point seed = {};
+    long double seed_length = 0;
+    for (size_t i = 0; i < n_mirrors; i++) {
+        long double sum = diagram.rings[i] ? 1.0L : 0.0L;
+        for (size_t j = 0; j < i; j++) {
+            sum -= normals[i][j] * seed[j];
+        }
+        seed[i] = sum / normals[i][i];
+        seed_length += seed[i] * seed[i];
+    }
+    for (auto& c : seed) {
+        c /= sqrtl(seed_length);
+    }
+
+    Mesh4 mesh;
+
+    // Vertices: the orbit of the generating point.
+    std::vector<u32> vertex_action;
+    {
+        PointIndex4 point_index;
+        std::vector<Point> points = {seed};
+        point_index.insert(to_dvec4(seed), 0);
+
+        for (u32 v = 0; v < points.size(); v++) {
+            if (v % 1024 == 0 && progress && progress->cancelled()) {
+                return mesh;
+            }
+            for (s32 s = 0; s < n_mirrors; s++) {
+                Point image = reflect(points[v], normals[s]);
+                u32 image_i;
+                if (!point_index.find(to_dvec4(image), image_i)) {
+                    image_i = (u32)points.size();
+                    CHECK_LT_F(image_i, max_vertices, "Polytope has too many vertices");
+                    point_index.insert(to_dvec4(image), image_i);
+                    points.push_back(image);
+                }
+                vertex_action.push_back(image_i);
+            }
+        }
+
+        mesh.vertices.reserve(points.size());
+        for (const auto& p : points) {
+            mesh.vertices.push_back(circumradius * to_dvec4(p));
+        }
+        LOG_F(INFO, "%lu vertices", mesh.vertices.size());
+    }
+
+    // Edges: one orbit for each ringed mirror, generated by the edge between
+    // the generating point and its reflection.
+    if (progress) {
+        progress->stage = GenerateProgress::Stage::edges;
+    }
+    RankElements edges;
+    u32 seed_edges[n_mirrors] = {};
+    for (s32 i = 0; i < n_mirrors; i++) {
+        if (diagram.rings[i]) {
+            u32 other = vertex_action[(u32)i];
+            seed_edges[i] = edges.find_or_add({0, other});
+        }
+    }
+    if (!edges.close(vertex_action, progress)) {
+        return mesh;
+    }
+    LOG_F(INFO, "Found %lu edges", edges.elements.size());
+    if (progress) {
+        progress->n_edges = (u32)edges.elements.size();
+        progress->stage = GenerateProgress::Stage::faces;
+    }
+
+    // Faces: for each active pair of mirrors, the seed face is the orbit of the
+    // seed edges under those two mirrors.
+    RankElements faces;
+    u32 seed_faces[1u << n_mirrors] = {};
+    for (u32 mirrors = 0; mirrors < (1u << n_mirrors); mirrors++) {
+        if (popcount(mirrors) == 2 && is_active_subset(diagram, mirrors)) {
+            std::vector<u32> start;
+            for (s32 i = 0; i < n_mirrors; i++) {
+                if ((mirrors & (1u << i)) && diagram.rings[i]) {
+                    start.push_back(seed_edges[i]);
+                }
+            }
+            seed_faces[mirrors] = faces.find_or_add(
+                    local_orbit(start, edges.action, (u32)edges.elements.size(), mirrors));
+        }
+    }
+    if (!faces.close(edges.action, progress)) {
+        return mesh;
+    }
+    LOG_F(INFO, "Found %lu faces", faces.elements.size());
+    if (progress) {
+        progress->n_faces = (u32)faces.elements.size();
+        progress->stage = GenerateProgress::Stage::cells;
+    }
+
+    // Cells: likewise for each active triple of mirrors, using the seed faces
+    // of its active pairs.
+    RankElements cells;
+    for (u32 mirrors = 0; mirrors < (1u << n_mirrors); mirrors++) {
+        if (popcount(mirrors) == 3 && is_active_subset(diagram, mirrors)) {
+            std::vector<u32> start;
+            for (u32 sub = 0; sub < (1u << n_mirrors); sub++) {
+                if ((sub & mirrors) == sub && popcount(sub) == 2 && is_active_subset(diagram, sub)) {
+                    start.push_back(seed_faces[sub]);
+                }
+            }
+            cells.find_or_add(local_orbit(start, faces.action, (u32)faces.elements.size(), mirrors));
+        }
+    }
+    if (!cells.close(faces.action, progress)) {
+        return mesh;
+    }
+    LOG_F(INFO, "Found %lu cells", cells.elements.size());
+
+    mesh.edges.reserve(edges.elements.size());
+    for (const auto& e : edges.elements) {
+        mesh.edges.push_back(Edge(e[0], e[1]));
+    }
+
+    mesh.faces = std::move(faces.elements);
+    mesh.cells = std::move(cells.elements);
+
+    mesh.name = strprintf("coxeter-%i-%i-%i-%i%i%i%i", diagram.branches[0], diagram.branches[1], diagram.branches[2],
+                          diagram.rings[0], diagram.rings[1], diagram.rings[2], diagram.rings[3]);
+    return mesh;
+}
+} // namespace four
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <four/mesh.hpp>
+
+namespace four {
+
+// A linear Coxeter-Dynkin diagram with four nodes:
+//
+//     o---o---o---o
+//       p   q   r
+//
+// `branches` holds the labels p, q and r (2 means the nodes are not
+// connected). `rings` marks the mirrors that the generating point lies off,
+// which selects the member of the uniform polytope family, e.g. 1000 is the
+// regular polytope {p,q,r}, 0100 its rectification and 1100 its truncation.
+struct CoxeterDiagram {
+    s32 branches[3];
+    bool rings[4];
+};
+
+// Parse a diagram written as "p,q,r:rings", e.g. "5,3,3:1100". Returns false
+// and logs an error if the string is malformed or the diagram does not
+// describe a finite (spherical) Coxeter group.
+bool parse_coxeter_diagram(const char* str, CoxeterDiagram& out);
+
+// Generate the uniform 4-polytope described by `diagram` using Wythoff's
+// construction. Vertices, edges, faces and cells are built directly as orbits
+// of the group generated by the diagram's reflections, so no geometric search
+// is needed. The result is scaled to a circumradius of 2. If `progress` is
+// given, it receives the stage of the generation and can cancel it, in which
+// case an incomplete mesh is returned.
+Mesh4 generate_wythoff(const CoxeterDiagram& diagram, GenerateProgress* progress = NULL);
+
+} // namespace four
@@ -1,7 +1,11 @@
 #include <four/app_state.hpp>
+#include <four/batch.hpp>
 #include <four/generate.hpp>
+#include <four/mesh_binary.hpp>
+#include <four/mesh_cache.hpp>
 #include <four/render.hpp>
 #include <four/resource.hpp>
+#include <four/volume.hpp>
 
 #include <SDL.h>
 #include <glad/glad.h>
@@ -11,6 +15,11 @@
 #include <loguru.hpp>
 
 #include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
 
 #ifdef __WIN32__
 #    include <windows.h>
@@ -43,7 +52,8 @@ int main(int argc, char** argv) {
         if (c_str_eq(arg, "-d")) {
             debug = true;
             open_console = true;
-        } else if (c_str_eq(arg, "--generate")) {
+        } else if (c_str_eq(arg, "--generate") || c_str_eq(arg, "--generate-all") || c_str_eq(arg, "--volume")
+                   || c_str_eq(arg, "--convert")) {
             open_console = true;
         }
     }
@@ -68,41 +78,140 @@ int main(int argc, char** argv) {
 
     init_resource_path();
 
+    GenerateOptions generate_options;
+    bool use_cache = true;
+    std::string cache_dir = get_cache_dir();
+    u64 cache_size_mib = 1024;
+    const char* volume_path = NULL;
+    const char* convert_paths[2] = {NULL, NULL};
+    bool binary = false;
+    BinaryMeshOptions binary_options;
+
     for (s32 i = 0; i < argc; i++) {
         auto arg = argv[i];
-        if (c_str_eq(arg, "--generate")) {
+        if (c_str_eq(arg, "--no-cache")) {
+            use_cache = false;
+
+        } else if (c_str_eq(arg, "--cache-dir")) {
+            CHECK_LT_F(i + 1, argc);
+            cache_dir = argv[i + 1];
+
+        } else if (c_str_eq(arg, "--cache-size")) {
             CHECK_LT_F(i + 1, argc);
             const char* arg1 = argv[i + 1];
 
-            Mesh4 mesh;
-            if (c_str_eq(arg1, "5-cell")) {
-                mesh = generate_5cell();
+            char* end;
+            cache_size_mib = strtoull(arg1, &end, 10);
+            if (end == arg1 || *end != '\0') {
+                ABORT_F("Invalid cache size %s", arg1);
+            }
 
-            } else if (c_str_eq(arg1, "Tesseract")) {
-                mesh = generate_tesseract();
+        } else if (c_str_eq(arg, "--cell-search")) {
+            CHECK_LT_F(i + 1, argc);
+            const char* arg1 = argv[i + 1];
 
-            } else if (c_str_eq(arg1, "16-cell")) {
-                mesh = generate_16cell();
+            if (c_str_eq(arg1, "hyperplanes")) {
+                generate_options.cell_search = CellSearch::hyperplanes;
+            } else if (c_str_eq(arg1, "dfs")) {
+                generate_options.cell_search = CellSearch::dfs;
+            } else if (c_str_eq(arg1, "symmetry")) {
+                generate_options.cell_search = CellSearch::symmetry;
+            } else {
+                ABORT_F("Unknown cell search method %s", arg1);
+            }
 
-            } else if (c_str_eq(arg1, "24-cell")) {
-                mesh = generate_24cell();
+        } else if (c_str_eq(arg, "--fewest-tets")) {
+            generate_options.tet_mode = TetMode::fewest;
 
-            } else if (c_str_eq(arg1, "120-cell")) {
-                mesh = generate_120cell();
+        } else if (c_str_eq(arg, "--volume")) {
+            CHECK_LT_F(i + 1, argc);
+            volume_path = argv[i + 1];
 
-            } else if (c_str_eq(arg1, "600-cell")) {
-                mesh = generate_600cell();
+        } else if (c_str_eq(arg, "--convert")) {
+            CHECK_LT_F(i + 2, argc);
+            convert_paths[0] = argv[i + 1];
+            convert_paths[1] = argv[i + 2];
 
-            } else {
-                ABORT_F("Unknown regular convex mesh4 %s", arg1);
+        } else if (c_str_eq(arg, "--binary")) {
+            binary = true;
+
+        } else if (c_str_eq(arg, "--compress")) {
+            binary_options.compress = true;
+
+        } else if (c_str_eq(arg, "--quantize")) {
+            CHECK_LT_F(i + 1, argc);
+            const char* arg1 = argv[i + 1];
+
+            char* end;
+            binary_options.quantize_bits = (u32)strtoul(arg1, &end, 10);
+            if (end == arg1 || *end != '\0'
+                || (binary_options.quantize_bits != 16 && binary_options.quantize_bits != 32)) {
+                ABORT_F("Invalid number of quantization bits %s", arg1);
             }
+        }
+    }
 
-            tetrahedralize(mesh);
+    if (convert_paths[0] != NULL) {
+        Mesh4 mesh;
+        if (!load_mesh_from_file(convert_paths[0], mesh)) {
+            return 1;
+        }
+        const size_t path_length = strlen(convert_paths[1]);
+        const size_t extension_length = strlen(binary_mesh_extension);
+        const bool to_binary = path_length >= extension_length
+                               && c_str_eq(convert_paths[1] + path_length - extension_length, binary_mesh_extension);
+        const bool saved =
+                to_binary ? save_mesh_binary(mesh, convert_paths[1], binary_options)
+                          : save_mesh_to_file(mesh, convert_paths[1]);
+        if (!saved) {
+            LOG_F(ERROR, "Could not save %s", convert_paths[1]);
+            return 1;
+        }
+        LOG_F(INFO, "Converted %s to %s", convert_paths[0], convert_paths[1]);
+        return 0;
+    }
 
-            auto path = mesh.name + ".mesh4";
-            CHECK_F(save_mesh_to_file(mesh, path.c_str()));
-            return 0;
+    if (volume_path != NULL) {
+        Mesh4 mesh;
+        if (!load_mesh_from_file(volume_path, mesh)) {
+            return 1;
+        }
+        VolumeMesh4 solid;
+        if (!mesh_interior(mesh, solid)) {
+            return 1;
         }
+
+        VolumeSlice slice;
+        slice_volume(solid, glm::dvec4(0, 0, 0, 1), 0.0, slice);
+        LOG_F(INFO, "%s: %lu pentatopes, hypervolume %f", mesh.name.c_str(), solid.pentatopes.size(),
+              hypervolume(solid));
+        LOG_F(INFO, "Cross section at w = 0: %lu tetrahedra, volume %f", slice.tets.size(), volume(slice));
+        return 0;
+    }
+
+    std::unique_ptr<MeshCache> mesh_cache;
+    if (use_cache && !cache_dir.empty()) {
+        mesh_cache = std::make_unique<MeshCache>(cache_dir, cache_size_mib << 20);
+    }
+
+    std::vector<std::string> generate_specs;
+    for (s32 i = 0; i < argc; i++) {
+        auto arg = argv[i];
+        if (c_str_eq(arg, "--generate")) {
+            CHECK_LT_F(i + 1, argc);
+            for (auto& spec : split_spec_list(argv[i + 1])) {
+                generate_specs.push_back(std::move(spec));
+            }
+        } else if (c_str_eq(arg, "--generate-all")) {
+            for (auto& spec : default_mesh_specs()) {
+                generate_specs.push_back(std::move(spec));
+            }
+        }
+    }
+
+    if (!generate_specs.empty()) {
+        const BinaryMeshOptions* batch_binary = binary ? &binary_options : NULL;
+        return generate_batch(generate_specs, generate_options, mesh_cache.get(), batch_binary) ? 0 : 1;
     }
 
     SDL_Window* window = NULL;
@@ -158,6 +267,8 @@ int main(int argc, char** argv) {
 
     AppState state(window, imgui_io);
     state.debug = debug;
+    state.mesh_cache = mesh_cache.get();
+    state.fewest_tets = generate_options.tet_mode == TetMode::fewest;
 
     Renderer renderer(&state);
 